@@ -0,0 +1,126 @@
+/* Hash function microbenchmark
+
+   Times xxh64, xxh3, murmur3, siphash and crc32c against md5 with hex
+   output, which was the usual way to hash keys before. md5 goes through
+   the same digest context and hex encoder as md5() of module. Kernels
+   are selected by module init as in nginx. Built in nginx source tree
+   configured with the module, see let_bench_num.c:
+
+   cc -O2 -no-pie -I objs -I src/core -I src/event -I src/event/modules \
+      -I src/os/unix -I src/http -I src/http/modules \
+      -o let_bench_hash /path/to/let/bench/let_bench_hash.c \
+      -Wl,--unresolved-symbols=ignore-all -lcrypto
+
+   ./let_bench_hash [iterations] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../ngx_http_let_module.c"
+
+#define NGX_LET_BENCH_DATA  4096   /* power of 2 */
+
+static u_char ngx_let_bench_data[NGX_LET_BENCH_DATA + 256];
+
+/* keeps results alive */
+static volatile uint64_t ngx_let_bench_sink;
+
+static double ngx_let_bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* key moves over data so each call hashes different bytes */
+#define ngx_let_bench(expr)                                                  \
+	start = ngx_let_bench_now();                                             \
+	for(i = 0, sum = 0; i < iters; ++i) {                                    \
+		p = ngx_let_bench_data + (i * 61 & (NGX_LET_BENCH_DATA - 1));        \
+		sum += (expr);                                                       \
+	}                                                                        \
+	ngx_let_bench_sink = sum;                                                \
+	printf("%8.1f", (ngx_let_bench_now() - start) / iters)
+
+static uint64_t ngx_let_bench_md5(const EVP_MD *md, u_char *p, size_t len)
+{
+	EVP_MD_CTX *mdctx;
+	u_char digest[EVP_MAX_MD_SIZE], hex[2 * EVP_MAX_MD_SIZE];
+	unsigned n;
+
+	mdctx = ngx_let_md_ctx();
+
+	EVP_DigestInit_ex(mdctx, md, NULL);
+	EVP_DigestUpdate(mdctx, p, len);
+	EVP_DigestFinal_ex(mdctx, digest, &n);
+
+	ngx_let_hex_encode(hex, digest, n);
+
+	return hex[0];
+}
+
+int main(int argc, char **argv)
+{
+	static size_t lens[] = { 16, 64, 256 };
+	ngx_cycle_t cycle;
+	ngx_log_t log;
+	const EVP_MD *md;
+	uint64_t key[2], x, sum;
+	u_char *p;
+	size_t len;
+	long iters, i;
+	ngx_uint_t n;
+	double start;
+
+	iters = argc > 1 ? atol(argv[1]) : 10000000;
+
+	ngx_memzero(&log, sizeof(ngx_log_t));
+	ngx_memzero(&cycle, sizeof(ngx_cycle_t));
+	cycle.log = &log;
+
+	ngx_http_let_init_module(&cycle);
+
+	md = ngx_let_digest_md(&log, &ngx_let_digest_md5);
+	if (md == NULL || ngx_let_md_ctx() == NULL) {
+		fprintf(stderr, "md5 is not available\n");
+		return 1;
+	}
+
+	for(i = 0, x = 88172645463325252ULL; i < (long) sizeof(ngx_let_bench_data);
+			++i)
+	{
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+
+		ngx_let_bench_data[i] = (u_char) x;
+	}
+
+	key[0] = 0x0706050403020100ULL;
+	key[1] = 0x0f0e0d0c0b0a0908ULL;
+
+	printf("ns per call, %ld calls:\n", iters);
+	printf("  key length %8s%8s%8s%8s%8s%10s\n", "xxh64", "xxh3", "murmur3",
+			"siphash", "crc32c", "md5 (hex)");
+
+	for(n = 0; n < sizeof(lens) / sizeof(lens[0]); ++n) {
+
+		len = lens[n];
+
+		printf("  %3zu bytes  ", len);
+
+		ngx_let_bench(ngx_let_xxh64(p, len));
+		ngx_let_bench(ngx_let_xxh3(p, len));
+		ngx_let_bench(ngx_let_murmur3(p, len));
+		ngx_let_bench(ngx_let_siphash(key, p, len));
+		ngx_let_bench(ngx_let_crc32c(p, len));
+		ngx_let_bench(ngx_let_bench_md5(md, p, len));
+
+		printf("\n");
+	}
+
+	return 0;
+}
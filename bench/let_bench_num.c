@@ -0,0 +1,118 @@
+/* Integer conversion microbenchmark
+
+   Compares ngx_let_itoa and ngx_let_toi with snprintf, strtoll and
+   ngx_atoi. Module source is included as is, so kernels measured are
+   exactly those nginx runs. Built in nginx source tree configured with
+   the module; only ngx_string.o is linked and other nginx symbols
+   referenced by module are never called:
+
+   cc -O2 -no-pie -I objs -I src/core -I src/event -I src/event/modules \
+      -I src/os/unix -I src/http -I src/http/modules \
+      -o let_bench_num /path/to/let/bench/let_bench_num.c \
+      objs/src/core/ngx_string.o -Wl,--unresolved-symbols=ignore-all
+
+   ./let_bench_num [iterations] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../ngx_http_let_module.c"
+
+#define NGX_LET_BENCH_VALUES  65536   /* power of 2 */
+
+static int64_t ngx_let_bench_values[NGX_LET_BENCH_VALUES];
+static u_char ngx_let_bench_strs[NGX_LET_BENCH_VALUES][NGX_INT64_LEN + 1];
+static size_t ngx_let_bench_lens[NGX_LET_BENCH_VALUES];
+
+/* keeps results alive */
+static volatile uint64_t ngx_let_bench_sink;
+
+static double ngx_let_bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void ngx_let_bench_report(const char *name, double start, long iters)
+{
+	printf("  %-16s %6.1f ns\n", name, (ngx_let_bench_now() - start) / iters);
+}
+
+int main(int argc, char **argv)
+{
+	u_char buf[NGX_INT64_LEN + 1];
+	ngx_str_t s;
+	uint64_t x, sum;
+	int64_t v;
+	long iters, i, n;
+	double start;
+
+	iters = argc > 1 ? atol(argv[1]) : 20000000;
+
+	/* all digit counts are equally likely; ngx_atoi does not take
+	   sign, so parsed values are non-negative */
+	for(i = 0, x = 88172645463325252ULL; i < NGX_LET_BENCH_VALUES; ++i) {
+
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+
+		/* 19 - i % 19 digits */
+		for(v = (int64_t) (x >> 1), n = i % 19; n; --n)
+			v /= 10;
+
+		ngx_let_bench_values[i] = (i & 1) ? -v : v;
+
+		ngx_let_bench_lens[i] = ngx_let_itoa(ngx_let_bench_strs[i], v)
+			- ngx_let_bench_strs[i];
+		ngx_let_bench_strs[i][ngx_let_bench_lens[i]] = '\0';
+	}
+
+	printf("formatting, %ld calls:\n", iters);
+
+	start = ngx_let_bench_now();
+	for(i = 0, sum = 0; i < iters; ++i)
+		sum += snprintf((char *) buf, sizeof(buf), "%lld",
+				(long long) ngx_let_bench_values[i & (NGX_LET_BENCH_VALUES - 1)]);
+	ngx_let_bench_sink = sum;
+	ngx_let_bench_report("snprintf \"%lld\"", start, iters);
+
+	start = ngx_let_bench_now();
+	for(i = 0, sum = 0; i < iters; ++i)
+		sum += ngx_let_itoa(buf,
+				ngx_let_bench_values[i & (NGX_LET_BENCH_VALUES - 1)]) - buf;
+	ngx_let_bench_sink = sum;
+	ngx_let_bench_report("ngx_let_itoa", start, iters);
+
+	printf("parsing, %ld calls:\n", iters);
+
+	start = ngx_let_bench_now();
+	for(i = 0, sum = 0; i < iters; ++i)
+		sum += strtoll((char *)
+				ngx_let_bench_strs[i & (NGX_LET_BENCH_VALUES - 1)], NULL, 10);
+	ngx_let_bench_sink = sum;
+	ngx_let_bench_report("strtoll", start, iters);
+
+	start = ngx_let_bench_now();
+	for(i = 0, sum = 0; i < iters; ++i)
+		sum += ngx_atoi(ngx_let_bench_strs[i & (NGX_LET_BENCH_VALUES - 1)],
+				ngx_let_bench_lens[i & (NGX_LET_BENCH_VALUES - 1)]);
+	ngx_let_bench_sink = sum;
+	ngx_let_bench_report("ngx_atoi", start, iters);
+
+	start = ngx_let_bench_now();
+	for(i = 0, sum = 0; i < iters; ++i) {
+		s.data = ngx_let_bench_strs[i & (NGX_LET_BENCH_VALUES - 1)];
+		s.len = ngx_let_bench_lens[i & (NGX_LET_BENCH_VALUES - 1)];
+		if (ngx_let_toi(&s, &v) == NGX_OK)
+			sum += v;
+	}
+	ngx_let_bench_sink = sum;
+	ngx_let_bench_report("ngx_let_toi", start, iters);
+
+	return 0;
+}
@@ -10,6 +10,12 @@
 #define NGX_LTYPE_FUNCTION  4
 #define NGX_LTYPE_CAPTURE   5
 
+/* operations not named by single character */
+#define NGX_LOP_EQ          0x100
+#define NGX_LOP_NE          0x101
+#define NGX_LOP_AND         0x102
+#define NGX_LOP_OR          0x103
+
 struct ngx_let_node_s {
 	
 	ngx_int_t type;
@@ -26,6 +32,21 @@ struct ngx_let_node_s {
 
 typedef struct ngx_let_node_s ngx_let_node_t;
 
+/* value flags */
+#define NGX_LET_VALUE_STR   0x01
+#define NGX_LET_VALUE_INT   0x02
+
+/* evaluated value; integer & string forms are converted lazily */
+typedef struct {
+
+	ngx_uint_t flags;
+
+	int64_t num;
+
+	ngx_str_t str;
+
+} ngx_let_value_t;
+
 /* parses let expression & returns to node pointer */
 ngx_let_node_t* ngx_parse_let_expr(ngx_conf_t* cf);
 
@@ -31,7 +31,7 @@ void yyerror(char *s) {
 
 ngx_let_node_t* ngx_let_binop_node_create(
 	ngx_let_node_t* left,
-	char op,
+	int op,
 	ngx_let_node_t* right) 
 {
 	ngx_let_node_t** args;
@@ -51,7 +51,7 @@ ngx_let_node_t* ngx_let_binop_node_create(
 
 /*	yylval = node;*/
 	
-	ngx_log_debug(NGX_LOG_INFO, conf->log, 0, "let operation reduce '%c'", op);
+	ngx_log_debug(NGX_LOG_INFO, conf->log, 0, "let operation reduce %d", op);
 
 	return node;
 }
@@ -80,7 +80,13 @@ ngx_let_node_t* ngx_let_fun_arg(
 
 %%
 
-%token NGXLEAF NGXFUNC NGXFUNC0 NGXDONE;
+%token NGXLEAF NGXFUNC NGXFUNC0 NGXDONE NGXEQ NGXNE NGXAND NGXOR;
+
+%left NGXOR ;
+
+%left NGXAND ;
+
+%left NGXEQ NGXNE '<' '>' ;
 
 %left '+' '-' ;
 
@@ -114,6 +120,18 @@ expr: '(' expr ')' { $$ = $2; }
 
 | expr '.' expr    { $$ = ngx_let_binop_node_create($1, '.', $3); }
 
+| expr NGXEQ expr  { $$ = ngx_let_binop_node_create($1, NGX_LOP_EQ, $3); }
+
+| expr NGXNE expr  { $$ = ngx_let_binop_node_create($1, NGX_LOP_NE, $3); }
+
+| expr '<' expr    { $$ = ngx_let_binop_node_create($1, '<', $3); }
+
+| expr '>' expr    { $$ = ngx_let_binop_node_create($1, '>', $3); }
+
+| expr NGXAND expr { $$ = ngx_let_binop_node_create($1, NGX_LOP_AND, $3); }
+
+| expr NGXOR expr  { $$ = ngx_let_binop_node_create($1, NGX_LOP_OR, $3); }
+
 ;
 
 funopen: NGXFUNC
@@ -124,10 +142,39 @@ funopen: NGXFUNC
 
 %%
 
+/* multi-character terminals */
+static struct {
+	char *name;
+	int token;
+} ngx_let_terminals[] = {
+	{ "==", NGXEQ },
+	{ "!=", NGXNE },
+	{ "&&", NGXAND },
+	{ "||", NGXOR },
+	{ NULL, 0 }
+};
+
+static int ngx_let_terminal(ngx_str_t* str) {
+
+	unsigned n;
+
+	if (str->len == 1 && strchr("+-*/%&|.()<>", str->data[0]))
+		return str->data[0];
+
+	for(n = 0; ngx_let_terminals[n].name; ++n) {
+		if (str->len == 2 
+				&& !ngx_strncmp(str->data, ngx_let_terminals[n].name, 2))
+			return ngx_let_terminals[n].token;
+	}
+
+	return 0;
+}
+
 int yylex() {
 
 	ngx_str_t* str;
 	ngx_let_node_t* node;
+	int token;
 
 	++inpos;
 	
@@ -140,20 +187,43 @@ int yylex() {
 
 	str = ((ngx_str_t*)conf->args->elts + inpos);
 
-	if (str->len == 1 && strchr("+-*/%&|.()", str->data[0])) {
+	token = ngx_let_terminal(str);
+
+	if (token) {
 
 		/* terminal */
 
 		yylval = 0;
 		
-		ngx_log_debug(NGX_LOG_INFO, conf->log, 0, "let terminal '%c'", str->data[0]);
+		ngx_log_debug(NGX_LOG_INFO, conf->log, 0, "let terminal '%*s'", str->len, str->data);
 
-		return str->data[0];
+		return token;
 	}
 	
 	node = ngx_pcalloc(conf->pool, sizeof(ngx_let_node_t));
 	yylval = node;
 
+	if (str->len > 1 && str->data[0] == '\\') {
+
+		/* escaped terminal is literal */
+
+		str->data++;
+		str->len--;
+
+		if (ngx_let_terminal(str)) {
+
+			ngx_log_debug(NGX_LOG_INFO, conf->log, 0, "let literal %*s", str->len, str->data);
+
+			node->type = NGX_LTYPE_LITERAL;
+			node->name = *str;
+
+			return NGXLEAF;
+		}
+
+		str->data--;
+		str->len++;
+	}
+
 	if (str->len > 1 && str->data[0] == '$') {
 		
 		/* variable */
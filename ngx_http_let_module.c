@@ -31,16 +31,32 @@ OF SUCH DAMAGE.
 #include <ngx_config.h>
 #include <ngx_core.h>
 #include <ngx_http.h>
-#include <stdlib.h>
-#include <time.h>
+#include <math.h>
 #include "let.h"
 
-#include <openssl/md4.h>
-#include <openssl/md5.h>
-#include <openssl/sha.h>
-#include <openssl/ripemd.h>
+#include <openssl/evp.h>
 
+#if (NGX_HAVE_GETRANDOM)
+#include <sys/random.h>
+#endif
+
+#if (defined __x86_64__ && defined __GNUC__)
+#define NGX_LET_HAVE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+static void* ngx_http_let_create_main_conf(ngx_conf_t *cf);
+static char* ngx_http_let_init_main_conf(ngx_conf_t *cf, void *conf);
+static void* ngx_http_let_create_loc_conf(ngx_conf_t *cf);
+static char* ngx_http_let_merge_loc_conf(ngx_conf_t *cf, void *parent,
+		void *child);
 static char* ngx_http_let_let(ngx_conf_t *cf, ngx_command_t *cmd, void *conf);
+static char* ngx_http_let_rand(ngx_conf_t *cf, ngx_command_t *cmd, void *conf);
+static char* ngx_http_let_zone(ngx_conf_t *cf, ngx_command_t *cmd, void *conf);
+static char* ngx_http_let_cache_zone(ngx_conf_t *cf, ngx_command_t *cmd,
+		void *conf);
+static ngx_int_t ngx_http_let_init_module(ngx_cycle_t *cycle);
+static ngx_int_t ngx_http_let_init_process(ngx_cycle_t *cycle);
 
 /* Module commands */
 static ngx_command_t ngx_http_let_commands[] = {
@@ -52,6 +68,27 @@ static ngx_command_t ngx_http_let_commands[] = {
 		0,
 		NULL },
 
+	{	ngx_string("let_rand"),
+		NGX_HTTP_LOC_CONF|NGX_CONF_TAKE3,
+		ngx_http_let_rand,
+		NGX_HTTP_LOC_CONF_OFFSET,
+		0,
+		NULL },
+
+	{	ngx_string("let_zone"),
+		NGX_HTTP_MAIN_CONF|NGX_CONF_TAKE2,
+		ngx_http_let_zone,
+		NGX_HTTP_MAIN_CONF_OFFSET,
+		0,
+		NULL },
+
+	{	ngx_string("let_cache_zone"),
+		NGX_HTTP_MAIN_CONF|NGX_CONF_TAKE2,
+		ngx_http_let_cache_zone,
+		NGX_HTTP_MAIN_CONF_OFFSET,
+		0,
+		NULL },
+
 	ngx_null_command
 };
 
@@ -60,12 +97,12 @@ static ngx_http_module_t ngx_http_let_module_ctx = {
 
     NULL,                              /* preconfiguration */
     NULL,                              /* postconfiguration */
-    NULL,                              /* create main configuration */
-    NULL,                              /* init main configuration */
+    ngx_http_let_create_main_conf,     /* create main configuration */
+    ngx_http_let_init_main_conf,       /* init main configuration */
     NULL,                              /* create server configuration */
     NULL,                              /* merge server configuration */
-    NULL,                              /* create location configuration */
-    NULL                               /* merge location configuration */
+    ngx_http_let_create_loc_conf,      /* create location configuration */
+    ngx_http_let_merge_loc_conf        /* merge location configuration */
 };
 
 /* Module */
@@ -76,8 +113,8 @@ ngx_module_t ngx_http_let_module = {
 	ngx_http_let_commands,             /* module directives */
 	NGX_HTTP_MODULE,                   /* module type */
 	NULL,                              /* init master */
-	NULL,                              /* init module */
-	NULL,                              /* init process */
+	ngx_http_let_init_module,          /* init module */
+	ngx_http_let_init_process,         /* init process */
 	NULL,                              /* init thread */
 	NULL,                              /* exit thread */
 	NULL,                              /* exit process */
@@ -85,450 +122,6971 @@ ngx_module_t ngx_http_let_module = {
 	NGX_MODULE_V1_PADDING
 };
 
-static ngx_int_t ngx_let_toi(ngx_str_t* s) 
-{
-	return (s->len > 2 && s->data[0] == '0' && s->data[1] == 'x')
-
-		? ngx_hextoi(s->data + 2, s->len - 2)
+/* Evaluation context; request is NULL while folding constants */
+typedef struct {
 
-		: ngx_atoi(s->data, s->len);
-}
+	ngx_http_request_t *request;
 
-/* Function engine */
-static ngx_int_t ngx_let_func_rand(ngx_http_request_t *r, ngx_str_t *ret)
-{
-	ret->len = 32;
-	ret->data = ngx_palloc(r->pool, ret->len);
+	ngx_pool_t *pool;
 
-	ret->len = ngx_snprintf(ret->data, ret->len, "%d", rand()) - ret->data;
+	ngx_log_t *log;
 
-	return NGX_OK;
-}
+	ngx_uint_t nocache;   /* non-cacheable variable was read */
 
-#define NGX_LET_HASHFUNC(fun, name, hashlen) \
-static ngx_int_t ngx_let_func_##name(ngx_http_request_t *r, \
-		ngx_str_t *arg, ngx_str_t *ret) \
-{ \
-	u_char md[hashlen]; \
-	unsigned n; \
-	u_char *s; \
-	static u_char hex[] = "0123456789abcdef"; \
-\
-	ret->len = sizeof(md) * 2; \
-	ret->data = ngx_palloc(r->pool, ret->len); \
-\
-	fun(arg->data, arg->len, md); \
-\
-	for(n = 0, s = ret->data; n < sizeof(md); ++n) { \
-		*s++ = hex[(md[n] >> 4) & 0x0f]; \
-		*s++ = hex[md[n] & 0x0f]; \
-	} \
-\
-	return NGX_OK; \
-}
+} ngx_let_ctx_t;
 
-NGX_LET_HASHFUNC(MD4, md4, 16)
-NGX_LET_HASHFUNC(MD5, md5, 16)
+/* Number conversion
 
-NGX_LET_HASHFUNC(SHA1,   sha1,   20)
-NGX_LET_HASHFUNC(SHA224, sha224, 28)
-NGX_LET_HASHFUNC(SHA256, sha256, 32)
-NGX_LET_HASHFUNC(SHA384, sha384, 48)
-NGX_LET_HASHFUNC(SHA512, sha512, 64)
+   Integers are formatted two digits at a time from lookup table and
+   decimal strings are parsed eight digits at a time (SWAR) */
 
-NGX_LET_HASHFUNC(RIPEMD160, ripemd160, 20)
+static u_char ngx_let_digits[] =
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
 
-static ngx_int_t ngx_let_func_length(ngx_http_request_t *r, 
-		ngx_str_t *str, ngx_str_t *ret)
+/* Writes decimal representation of n to p, at most NGX_INT64_LEN bytes;
+   returns end of output */
+static u_char* ngx_let_itoa(u_char* p, int64_t n)
 {
-	ret->len = 32;
-	ret->data = ngx_palloc(r->pool, ret->len);
+	uint64_t u, q;
+	ngx_uint_t len, d;
+	u_char* e;
 
-	ret->len = ngx_snprintf(ret->data, ret->len, "%d", str->len) - ret->data;
+	if (n < 0) {
+		*p++ = '-';
+		u = - (uint64_t) n;
+	} else {
+		u = n;
+	}
 
-	return NGX_OK;
-}
+	for(len = 1, q = u; q >= 10; q /= 10, ++len);
 
-#define NGX_LET_ICMPFUNC(name, op) \
-static ngx_int_t ngx_let_func_##name(ngx_http_request_t *r, \
-		ngx_str_t *a1, ngx_str_t *a2, ngx_str_t *ret) \
-{ \
-	ngx_int_t v1, v2; \
-	ret->len = 32; \
-	ret->data = ngx_palloc(r->pool, ret->len); \
-\
-	v1 = ngx_atoi(a1->data, a1->len); \
-	v2 = ngx_atoi(a2->data, a2->len); \
-\
-	ret->len = ngx_snprintf(ret->data, ret->len, "%d", \
-		v1 op v2 ? v1 : v2) - ret->data; \
-\
-	return NGX_OK; \
+	e = p + len;
+	p = e;
+
+	while (u >= 100) {
+		d = (u % 100) * 2;
+		u /= 100;
+		*--p = ngx_let_digits[d + 1];
+		*--p = ngx_let_digits[d];
+	}
+
+	if (u >= 10) {
+		d = u * 2;
+		*--p = ngx_let_digits[d + 1];
+		*--p = ngx_let_digits[d];
+	} else {
+		*--p = (u_char) ('0' + u);
+	}
+
+	return e;
 }
 
-NGX_LET_ICMPFUNC(min, <)
-NGX_LET_ICMPFUNC(max, >)
+#if (NGX_HAVE_LITTLE_ENDIAN)
 
-static ngx_int_t ngx_let_func_substr(ngx_http_request_t *r, 
-		ngx_str_t *str, ngx_str_t *offset,
-		ngx_str_t *length, ngx_str_t *ret)
+/* Converts 8 decimal digits at once; returns NGX_ERROR on non-digit */
+static ngx_int_t ngx_let_parse8(u_char* p, uint64_t* n)
 {
-	ngx_int_t offs, len;
+	uint64_t v;
 
-	*ret = *str;
+	ngx_memcpy(&v, p, 8);
 
-	offs = ngx_atoi(offset->data, offset->len);
-	len = ngx_atoi(length->data, length->len);
+	if ((v & 0xf0f0f0f0f0f0f0f0ULL) != 0x3030303030303030ULL
+			|| ((v + 0x0606060606060606ULL) & 0xf0f0f0f0f0f0f0f0ULL) 
+				!= 0x3030303030303030ULL)
+		return NGX_ERROR;
 
-	if (offs >= (ngx_int_t)ret->len) {
-		ret->len = 0;
-		return NGX_OK;
-	}
+	v -= 0x3030303030303030ULL;
 
-	ret->data += offs;
+	v = v * 10 + (v >> 8);
+	v = (((v & 0x000000ff000000ffULL) * (100 + (1000000ULL << 32)))
+		+ (((v >> 16) & 0x000000ff000000ffULL) * (1 + (10000ULL << 32)))) >> 32;
 
-	if (!len || offs + len >= (ngx_int_t)ret->len)
-		ret->len -= offs;
-	else
-		ret->len = len;
+	*n = v;
 
 	return NGX_OK;
 }
 
-/* Call function by name & return result */
-static ngx_int_t ngx_let_call_fun(ngx_http_request_t *r,
-		ngx_str_t *name, ngx_array_t *args, ngx_str_t *value)
+#endif
+
+static ngx_inline ngx_int_t ngx_let_hex(u_char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+
+	c |= 0x20;
+
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+
+	return NGX_ERROR;
+}
+
+/* Parses decimal with optional '-' or hexadecimal with 0x prefix
+   within int64 range */
+static ngx_int_t ngx_let_toi(ngx_str_t* s, int64_t* n) 
 {
-	ngx_str_t *sargs = args->elts;
+	u_char *p, *last;
+	uint64_t v;
+	ngx_uint_t neg;
+	ngx_int_t d;
+#if (NGX_HAVE_LITTLE_ENDIAN)
+	uint64_t v8;
+#endif
+
+	p = s->data;
+	last = p + s->len;
+	v = 0;
+
+	if (s->len > 2 && p[0] == '0' && p[1] == 'x') {
 
-	/* TODO: implement hashtable for faster lookup */
+		/* skip leading zeros so length limits value */
+		for(p += 2; p != last - 1 && *p == '0'; ++p);
 
-#define IF_FUNC(nm, nargs) \
-	if (sizeof(#nm) - 1 == name->len \
-			&& !ngx_strncmp(#nm, name->data, name->len)) { \
-		if (nargs != args->nelts) { \
-			ngx_log_debug4(NGX_LOG_DEBUG_HTTP, r->connection->log, 0, \
-				"let function '%*s' expects %d arguments, %d provided", \
-					name->len, name->data, nargs, args->nelts); \
-			return NGX_ERROR; \
+		if (last - p > 15 && (last - p > 16 || ngx_let_hex(*p) > 7))
+			return NGX_ERROR;
+
+		for(; p != last; ++p) {
+
+			d = ngx_let_hex(*p);
+			if (d == NGX_ERROR)
+				return NGX_ERROR;
+
+			v = (v << 4) | d;
 		}
 
-#define CALL_FUNC_0(nm) \
-	IF_FUNC(nm, 0) \
-		return ngx_let_func_##nm(r, value); \
-	}
+		*n = v;
 
-#define CALL_FUNC_1(nm) \
-	IF_FUNC(nm, 1) \
-		return ngx_let_func_##nm(r, sargs, value); \
+		return NGX_OK;
 	}
 
-#define CALL_FUNC_2(nm) \
-	IF_FUNC(nm, 2) \
-		return ngx_let_func_##nm(r, sargs, sargs + 1, value); \
-	}
+	neg = (s->len > 1 && p[0] == '-');
+	p += neg;
 
-#define CALL_FUNC_3(nm) \
-	IF_FUNC(nm, 3) \
-		return ngx_let_func_##nm(r, sargs, sargs + 1, sargs + 2, value); \
+	if (p == last)
+		return NGX_ERROR;
+
+	for(; p != last - 1 && *p == '0'; ++p);
+
+	/* 19 digits never overflow uint64 */
+	if (last - p > 19)
+		return NGX_ERROR;
+
+#if (NGX_HAVE_LITTLE_ENDIAN)
+
+	for(; last - p >= 8; p += 8) {
+
+		if (ngx_let_parse8(p, &v8) != NGX_OK)
+			return NGX_ERROR;
+
+		v = v * 100000000 + v8;
 	}
-	
-	CALL_FUNC_0(rand);
 
-	/* cryptographic hashes */
-	CALL_FUNC_1(md4);
-	CALL_FUNC_1(md5);
+#endif
 
-	CALL_FUNC_1(sha1);
-	CALL_FUNC_1(sha224);
-	CALL_FUNC_1(sha256);
-	CALL_FUNC_1(sha384);
-	CALL_FUNC_1(sha512);
+	for(; p != last; ++p) {
 
-	CALL_FUNC_1(ripemd160);
+		if (*p < '0' || *p > '9')
+			return NGX_ERROR;
 
-	/* string operations */
-	CALL_FUNC_1(length);
-	CALL_FUNC_3(substr);
+		v = v * 10 + (*p - '0');
+	}
 
-	/* integer operations */
-	CALL_FUNC_2(max);
-	CALL_FUNC_2(min);
+	if (v > (uint64_t) INT64_MAX + neg)
+		return NGX_ERROR;
 
-	ngx_log_error(NGX_LOG_ALERT, r->connection->log, 0,
-				"let undefined function '%*s'", name->len, name->data);
+	*n = neg ? (int64_t) (0 - v) : (int64_t) v;
 
-	return NGX_ERROR;
+	return NGX_OK;
 }
 
-/* Processes positive integers only */
-static ngx_int_t ngx_let_apply_binary_integer_op(ngx_http_request_t *r, int op, 
-		ngx_array_t* args, ngx_str_t* value)
+/* Value conversion; converted form is kept in value */
+static ngx_int_t ngx_let_value_int(ngx_let_ctx_t *ctx, ngx_let_value_t *v)
 {
-	ngx_str_t* str;
-	int left, right;
-	unsigned sz;
+	if (v->flags & NGX_LET_VALUE_INT)
+		return NGX_OK;
 
-	if (args->nelts != 2) {
-		ngx_log_error(NGX_LOG_ALERT, r->connection->log, 0, 
-				"let not enough argument for binary operation");
+	if (ngx_let_toi(&v->str, &v->num) != NGX_OK) {
+		ngx_log_error(NGX_LOG_ALERT, ctx->log, 0, 
+				"let error parsing argument '%*s'", v->str.len, v->str.data);
 		return NGX_ERROR;
 	}
-	
-	str = args->elts;
 
-	left = ngx_let_toi(str);
-	if (left != NGX_ERROR) {
-		++str;
-		right = ngx_let_toi(str);
-	}
-	
-	if (left == NGX_ERROR || right == NGX_ERROR) {
-		ngx_log_error(NGX_LOG_ALERT, r->connection->log, 0, 
-				"let error parsing argument '%*s'", str->len, str->data);
+	v->flags |= NGX_LET_VALUE_INT;
+
+	return NGX_OK;
+}
+
+static ngx_int_t ngx_let_value_str(ngx_let_ctx_t *ctx, ngx_let_value_t *v)
+{
+	if (v->flags & NGX_LET_VALUE_STR)
+		return NGX_OK;
+
+	v->str.data = ngx_pnalloc(ctx->pool, NGX_INT64_LEN);
+	if (v->str.data == NULL)
 		return NGX_ERROR;
-	}
-	
-	switch(op) {
-		
-		case '+':
-			left += right;
-			break;
-			
-		case '-':
-			left -= right;
-			break;
 
-		case '*':
-			left *= right;
-			break;
+	v->str.len = ngx_let_itoa(v->str.data, v->num) - v->str.data;
 
-		case '/':
-			left /= right;
-			break;
+	v->flags |= NGX_LET_VALUE_STR;
 
-		case '%':
-			left %= right;
-			break;
+	return NGX_OK;
+}
 
-		case '&':
-			left &= right;
-			break;
+/* Hex encoding
 
-		case '|':
-			left |= right;
-			break;
+   Digests are encoded 16 or 32 bytes at a time with byte shuffles when
+   CPU supports it. Encoder is selected when module is initialized;
+   constants folded while parsing config use scalar one. */
 
-		default:
-			ngx_log_error(NGX_LOG_ALERT, r->connection->log, 0, 
-					"let unexpected operation '%c'", op);
-			return NGX_ERROR;
+typedef u_char* (*ngx_let_hex_pt)(u_char* dst, u_char* src, size_t len);
+
+static u_char ngx_let_hex_digits[] = "0123456789abcdef";
+
+static u_char* ngx_let_hex_scalar(u_char* dst, u_char* src, size_t len)
+{
+	while (len--) {
+		*dst++ = ngx_let_hex_digits[*src >> 4];
+		*dst++ = ngx_let_hex_digits[*src++ & 0x0f];
 	}
-	
-	value->len = 64; /*TODO: better size? */
-	value->data = ngx_palloc(r->pool, value->len);
-	
-	sz = snprintf((char*)value->data, value->len, "%d", left);
 
-	if (sz < value->len)
-		value->len = sz;
-	
-	ngx_log_debug3(NGX_LOG_DEBUG_HTTP, r->connection->log, 0, 
-			"let applying binary operation '%c' %d: %d", op, right, left);
+	return dst;
+}
 
-	return NGX_OK;
+#if (NGX_LET_HAVE_X86_SIMD)
+
+__attribute__((target("ssse3")))
+static u_char* ngx_let_hex_ssse3(u_char* dst, u_char* src, size_t len)
+{
+	__m128i digits, mask, v, hi, lo;
+
+	digits = _mm_loadu_si128((__m128i*) ngx_let_hex_digits);
+	mask = _mm_set1_epi8(0x0f);
+
+	for(; len >= 16; len -= 16, src += 16, dst += 32) {
+
+		v = _mm_loadu_si128((__m128i*) src);
+
+		hi = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(v, 4), mask));
+		lo = _mm_shuffle_epi8(digits, _mm_and_si128(v, mask));
+
+		_mm_storeu_si128((__m128i*) dst, _mm_unpacklo_epi8(hi, lo));
+		_mm_storeu_si128((__m128i*) (dst + 16), _mm_unpackhi_epi8(hi, lo));
+	}
+
+	return ngx_let_hex_scalar(dst, src, len);
 }
 
-static ngx_int_t ngx_let_get_node_value(ngx_http_request_t* r, ngx_let_node_t* node,
-		ngx_str_t* value)
+__attribute__((target("avx2")))
+static u_char* ngx_let_hex_avx2(u_char* dst, u_char* src, size_t len)
 {
-	ngx_http_variable_value_t* vv;
-	ngx_array_t args;
-	ngx_let_node_t** anode;
-	ngx_str_t* astr;
-	ngx_uint_t n;
-	ngx_int_t ret;
-	u_char* s;
-	int *cap;
-	ngx_int_t ncap;
+	__m256i digits, mask, v, hi, lo, a, b;
+	__m128i v16, hi16, lo16;
 
-	if (node == NULL) {
-		ngx_log_error(NGX_LOG_ALERT, r->connection->log, 0, 
-				"let NULL node");
-		return NGX_ERROR;
+	digits = _mm256_broadcastsi128_si256(
+			_mm_loadu_si128((__m128i*) ngx_let_hex_digits));
+	mask = _mm256_set1_epi8(0x0f);
+
+	for(; len >= 32; len -= 32, src += 32, dst += 64) {
+
+		v = _mm256_loadu_si256((__m256i*) src);
+
+		hi = _mm256_shuffle_epi8(digits, 
+				_mm256_and_si256(_mm256_srli_epi16(v, 4), mask));
+		lo = _mm256_shuffle_epi8(digits, _mm256_and_si256(v, mask));
+
+		/* unpacking works within 128-bit lanes */
+		a = _mm256_unpacklo_epi8(hi, lo);
+		b = _mm256_unpackhi_epi8(hi, lo);
+
+		_mm256_storeu_si256((__m256i*) dst, 
+				_mm256_permute2x128_si256(a, b, 0x20));
+		_mm256_storeu_si256((__m256i*) (dst + 32), 
+				_mm256_permute2x128_si256(a, b, 0x31));
 	}
 
-	switch(node->type) {
-		
-		case NGX_LTYPE_VARIABLE:
-			
-			vv = ngx_http_get_indexed_variable(r, node->index);
-				
-			if (vv == NULL || vv->not_found) {
-				ngx_log_error(NGX_LOG_ALERT, r->connection->log, 0, 
-						"let variable %d not found", node->index);
-					
-				return NGX_ERROR;
-			}
+	/* not calling SSE version to avoid AVX-SSE transition penalty */
+	if (len >= 16) {
 
-			value->data = vv->data;
-			value->len = vv->len;
-			
-			ngx_log_debug3(NGX_LOG_DEBUG_HTTP, r->connection->log, 0, 
-						"let getting variable %d: '%*s'", node->index, value->len, value->data);
+		v16 = _mm_loadu_si128((__m128i*) src);
 
-			break;
+		hi16 = _mm_shuffle_epi8(_mm256_castsi256_si128(digits),
+				_mm_and_si128(_mm_srli_epi16(v16, 4), 
+					_mm256_castsi256_si128(mask)));
+		lo16 = _mm_shuffle_epi8(_mm256_castsi256_si128(digits),
+				_mm_and_si128(v16, _mm256_castsi256_si128(mask)));
 
-		case NGX_LTYPE_CAPTURE:
+		_mm_storeu_si128((__m128i*) dst, _mm_unpacklo_epi8(hi16, lo16));
+		_mm_storeu_si128((__m128i*) (dst + 16), _mm_unpackhi_epi8(hi16, lo16));
 
-			if (node->index >= (ngx_int_t)r->ncaptures)
-				return NGX_ERROR;
+		len -= 16;
+		src += 16;
+		dst += 32;
+	}
+
+	return ngx_let_hex_scalar(dst, src, len);
+}
 
-			cap = r->captures;
+#endif
 
-			ncap = node->index * 2;
+static ngx_let_hex_pt ngx_let_hex_encode = ngx_let_hex_scalar;
 
-			value->data = r->captures_data + cap[ncap];
-			value->len = cap[ncap + 1] - cap[ncap];
+#define ngx_let_rotl32(x, r) (((x) << (r)) | ((x) >> (32 - (r))))
+#define ngx_let_rotl64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
 
-			ngx_log_debug3(NGX_LOG_DEBUG_HTTP, r->connection->log, 0, 
-						"let getting capture %d: '%*s'", node->index, value->len, value->data);
+#define ngx_let_set_int(v, n) \
+	(v)->flags = NGX_LET_VALUE_INT; \
+	(v)->num = (n)
 
-			break;
-			
-		case NGX_LTYPE_LITERAL:
-			
-			*value = node->name;
-			
-			ngx_log_debug2(NGX_LOG_DEBUG_HTTP, r->connection->log, 0, 
-						"let getting literal: '%*s'", value->len, value->data);
-			
-			break;
+/* Function engine */
+typedef ngx_int_t (*ngx_let_func_pt)(ngx_let_ctx_t *ctx,
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret);
 
-		case NGX_LTYPE_FUNCTION:
+/* Prepares call site data from constant arguments; args[n].flags is 0
+   if argument is not constant */
+typedef char* (*ngx_let_func_init_pt)(ngx_conf_t *cf, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void **data);
 
-			ngx_log_debug3(NGX_LOG_DEBUG_HTTP, r->connection->log, 0, 
-						"let calling function '%*s'; argc: %d", 
-						node->name.len, node->name.data, node->args.nelts);
-			
-			/* parse arguments */
-			ngx_array_init(&args, r->pool, node->args.nelts, sizeof(ngx_str_t));
+/* function flags */
+#define NGX_LET_FUNC_PURE    0x01  /* result depends on arguments only */
+#define NGX_LET_FUNC_CONCAT  0x02  /* arguments are concatenated */
+#define NGX_LET_FUNC_KEY     0x04  /* except first one */
 
-			astr = ngx_array_push_n(&args, node->args.nelts);
-			anode = node->args.elts;
-		
-			for(n = 0; n < node->args.nelts; ++n) {
-				
-				ret = ngx_let_get_node_value(r, *anode++, astr++);
-				if (ret != NGX_OK)
-					return ret;
-			}
+/* no limit on number of arguments other than stack size */
+#define NGX_LET_VARARGS      ((ngx_uint_t) -1)
 
-			ret = ngx_let_call_fun(r, &node->name, &args, value);
+typedef struct {
 
-			if (ret != NGX_OK)
-				return ret;
+	ngx_str_t name;
 
-			break;
-			
-		case NGX_LTYPE_OPERATION:
-			
-			ngx_log_debug2(NGX_LOG_DEBUG_HTTP, r->connection->log, 0, 
-						"let applying operation '%c'; argc: %d", node->index, node->args.nelts);
-			
-			/* parse arguments */
-			ngx_array_init(&args, r->pool, node->args.nelts, sizeof(ngx_str_t));
+	ngx_uint_t min_args;
 
-			astr = ngx_array_push_n(&args, node->args.nelts);
-			anode = node->args.elts;
-		
-			for(n = 0; n < node->args.nelts; ++n) {
-				
-				ret = ngx_let_get_node_value(r, *anode++, astr++);
-				if (ret != NGX_OK)
-					return ret;
-			}
-			
-			if (strchr("+-*/%&|", node->index)) {
-				
-				/* binary integer operation */
+	ngx_uint_t max_args;
 
-				ret = ngx_let_apply_binary_integer_op(r, node->index, &args, value);
-				if (ret != NGX_OK)
-					return ret;
-				
-			} else if (node->index == '.') {
-				
-				/* string concatenation */
-
-				value->len = 0;
-				astr = args.elts;
-				
-				for(n = 0; n < args.nelts; ++n, ++astr)
-					value->len += astr->len;
-
-				value->data = ngx_palloc(r->pool, value->len);
-
-				astr = args.elts;
-				s = value->data;
-				for(n = 0, s = value->data; n < args.nelts; ++n, s += astr++->len)
-					memcpy(s, astr->data, astr->len);
-				
-				ngx_log_debug3(NGX_LOG_DEBUG_HTTP, r->connection->log, 0, 
-						"let %d strings concatenated '%*s'", args.nelts, value->len, value->data);
-			}
+	ngx_uint_t flags;
 
-			break;
+	ngx_let_func_pt handler;
+
+	ngx_let_func_init_pt init;
+
+} ngx_let_func_t;
+
+/* Random numbers
+
+   Each worker runs its own xoshiro256** generator seeded from kernel
+   entropy when process starts, so workers never share sequence and no
+   lock is taken */
+
+static uint64_t ngx_let_random_state[4];
+
+static ngx_inline uint64_t ngx_let_random(void)
+{
+	uint64_t *s = ngx_let_random_state;
+	uint64_t r, t;
+
+	r = ngx_let_rotl64(s[1] * 5, 7) * 9;
+	t = s[1] << 17;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = ngx_let_rotl64(s[3], 45);
+
+	return r;
+}
+
+/* Uniform in [0, n) by multiply-shift; rejection of the few biased
+   products needs division only when it can happen at all */
+static ngx_inline uint64_t ngx_let_random_bounded(uint64_t n)
+{
+#if (defined __SIZEOF_INT128__)
+	__uint128_t m;
+	uint64_t t;
+
+	m = (__uint128_t) ngx_let_random() * n;
+
+	if ((uint64_t) m < n) {
+
+		t = - n % n;
+
+		while ((uint64_t) m < t)
+			m = (__uint128_t) ngx_let_random() * n;
 	}
 
-	return NGX_OK;
+	return (uint64_t) (m >> 64);
+#else
+	uint64_t x, t;
+
+	t = - n % n;
+
+	do {
+		x = ngx_let_random();
+	} while (x < t);
+
+	return x % n;
+#endif
 }
 
-static ngx_int_t ngx_http_let_variable(ngx_http_request_t *r,
-		    ngx_http_variable_value_t *v, uintptr_t data)
+static void ngx_let_random_seed(ngx_log_t *log)
 {
-	ngx_let_node_t* node = (ngx_let_node_t*)data;
-	ngx_str_t value;
-	ngx_int_t ret;
+	uint64_t *s = ngx_let_random_state;
+	uint64_t z;
+	ngx_uint_t n;
 
-	ret = ngx_let_get_node_value(r, node, &value);
+#if (NGX_HAVE_GETRANDOM)
+	if (getrandom(s, 4 * sizeof(uint64_t), 0) == 4 * sizeof(uint64_t))
+		return;
 
-	if (ret == NGX_OK) {
+	ngx_log_error(NGX_LOG_WARN, log, ngx_errno,
+			"let getrandom() failed, seeding from time and pid");
+#endif
 
-		v->len = value.len;
-		v->data = value.data;
-		v->valid = 1;
-		v->no_cacheable = 0;
-		v->not_found = 0;
-			
-		ngx_log_debug0(NGX_LOG_DEBUG_HTTP, r->connection->log, 0, "let variable accessed");
+	/* state is expanded with splitmix64 so it is never all zero */
+	z = (uint64_t) ngx_time() ^ ((uint64_t) ngx_pid << 32)
+		^ (uint64_t) (uintptr_t) s;
+
+	for(n = 0; n < 4; ++n) {
+		z += 0x9E3779B97F4A7C15ULL;
+		s[n] = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		s[n] = (s[n] ^ (s[n] >> 27)) * 0x94D049BB133111EBULL;
+		s[n] ^= s[n] >> 31;
 	}
+}
 
-	return ret;
+/* rand(); rand( n ) is in [0, n); rand( from to ) includes both bounds.
+   Range is computed once at config time if bounds are constant */
+typedef struct {
+
+	int64_t low;
+
+	uint64_t range;       /* 0 if all 2^64 values */
+
+} ngx_let_rand_t;
+
+static char* ngx_let_rand_range(ngx_let_value_t *args, ngx_uint_t nargs,
+		ngx_let_rand_t *rr)
+{
+	int64_t high;
+
+	if (nargs == 1) {
+
+		if (args[0].num < 1)
+			return "needs positive random range";
+
+		rr->low = 0;
+		high = args[0].num - 1;
+
+	} else {
+
+		if (args[0].num > args[1].num)
+			return "has empty random range";
+
+		rr->low = args[0].num;
+		high = args[1].num;
+	}
+
+	rr->range = (uint64_t) high - (uint64_t) rr->low + 1;
+
+	return NULL;
 }
 
-static char* ngx_http_let_let(ngx_conf_t *cf, ngx_command_t *cmd, void *conf)
+static ngx_int_t ngx_let_func_rand(ngx_let_ctx_t *ctx,
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
 {
-	ngx_str_t *value;
-	ngx_http_variable_t *v;
+	ngx_let_rand_t *rr, tmp;
+	ngx_uint_t n;
+	char *err;
 
-	srand(time(0));
-	
-	value = cf->args->elts;
-	
-	ngx_log_debug0(NGX_LOG_INFO, cf->log, 0, "let command handler");
+	if (nargs == 0) {
+		ngx_let_set_int(ret, ngx_let_random() >> 33);
+		return NGX_OK;
+	}
 
-	if (value[1].data[0] != '$')
-		return "needs variable as the first argument";
+	rr = data;
 
-	value[1].data++;
-	value[1].len--;
+	if (rr == NULL) {
 
-	v = ngx_http_add_variable(cf, &value[1], NGX_HTTP_VAR_CHANGEABLE);
+		for(n = 0; n < nargs; ++n) {
+			if (ngx_let_value_int(ctx, &args[n]) != NGX_OK)
+				return NGX_ERROR;
+		}
+
+		err = ngx_let_rand_range(args, nargs, &tmp);
+		if (err) {
+			ngx_log_error(NGX_LOG_ALERT, ctx->log, 0, "let rand %s", err);
+			return NGX_ERROR;
+		}
+
+		rr = &tmp;
+	}
+
+	ngx_let_set_int(ret, (int64_t) ((uint64_t) rr->low + (rr->range 
+				? ngx_let_random_bounded(rr->range) : ngx_let_random())));
+
+	return NGX_OK;
+}
+
+static char* ngx_let_func_rand_init(ngx_conf_t *cf,
+		ngx_let_value_t *args, ngx_uint_t nargs, void **data)
+{
+	ngx_let_rand_t *rr;
+	ngx_uint_t n;
+	char *err;
+
+	for(n = 0; n < nargs; ++n) {
+
+		/* bounds known per request only */
+		if (args[n].flags == 0)
+			return NGX_CONF_OK;
+
+		if (!(args[n].flags & NGX_LET_VALUE_INT))
+			return "requires integer random range";
+	}
+
+	if (nargs == 0)
+		return NGX_CONF_OK;
+
+	rr = ngx_palloc(cf->pool, sizeof(ngx_let_rand_t));
+	if (rr == NULL)
+		return NGX_CONF_ERROR;
+
+	err = ngx_let_rand_range(args, nargs, rr);
+	if (err)
+		return err;
+
+	*data = rr;
+
+	return NGX_CONF_OK;
+}
+
+static ngx_int_t ngx_let_func_rand64(ngx_let_ctx_t *ctx,
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	ngx_let_set_int(ret, ngx_let_random() & INT64_MAX);
+
+	return NGX_OK;
+}
+
+/* digest output encodings */
+#define NGX_LET_ENC_HEX      0
+#define NGX_LET_ENC_RAW      1
+#define NGX_LET_ENC_B64U     2
+
+#define ngx_let_b64u_length(len) (((len) * 4 + 2) / 3)
+
+static ngx_int_t ngx_let_digest_output(ngx_let_ctx_t *ctx, u_char* md,
+		size_t len, ngx_uint_t enc, ngx_let_value_t *ret)
+{
+	ngx_str_t src;
+
+	ret->flags = NGX_LET_VALUE_STR;
+
+	switch(enc) {
+
+		case NGX_LET_ENC_RAW:
+			ret->str.len = len;
+			break;
+
+		case NGX_LET_ENC_B64U:
+			ret->str.len = ngx_let_b64u_length(len);
+			break;
+
+		default:
+			ret->str.len = len * 2;
+	}
+
+	ret->str.data = ngx_pnalloc(ctx->pool, ret->str.len);
+	if (ret->str.data == NULL)
+		return NGX_ERROR;
+
+	switch(enc) {
+
+		case NGX_LET_ENC_RAW:
+			ngx_memcpy(ret->str.data, md, len);
+			break;
+
+		case NGX_LET_ENC_B64U:
+			src.data = md;
+			src.len = len;
+			ngx_encode_base64url(&ret->str, &src);
+			break;
+
+		default:
+			ngx_let_hex_encode(ret->str.data, md, len);
+	}
+
+	return NGX_OK;
+}
+
+/* Digests are computed incrementally over arguments so concatenation
+   is never materialized */
+typedef struct {
+
+	char *name;
+
+	const EVP_MD *md;     /* resolved on first use */
+
+} ngx_let_digest_t;
+
+static const EVP_MD* ngx_let_digest_md(ngx_log_t *log, ngx_let_digest_t *d)
+{
+	if (d->md == NULL) {
+
+		/* explicit fetch saves provider lookup on each call */
+#if (OPENSSL_VERSION_NUMBER >= 0x30000000L)
+		d->md = EVP_MD_fetch(NULL, d->name, NULL);
+#else
+		d->md = EVP_get_digestbyname(d->name);
+#endif
+
+		if (d->md == NULL) {
+			ngx_log_error(NGX_LOG_ALERT, log, 0, 
+					"let digest \"%s\" is not available", d->name);
+		}
+	}
+
+	return d->md;
+}
+
+/* Per-worker digest context */
+static EVP_MD_CTX* ngx_let_md_ctx(void)
+{
+	static EVP_MD_CTX *mdctx;
+
+	if (mdctx == NULL)
+		mdctx = EVP_MD_CTX_new();
+
+	return mdctx;
+}
+
+/* Feeds arguments to digest as their concatenation */
+static int ngx_let_digest_update(EVP_MD_CTX *mdctx, ngx_let_value_t *args,
+		ngx_uint_t nargs)
+{
+	u_char num[NGX_INT64_LEN];
+	ngx_uint_t n;
+	int rc;
+
+	for(n = 0, rc = 1; rc && n < nargs; ++n) {
+
+		rc = (args[n].flags & NGX_LET_VALUE_STR)
+			? EVP_DigestUpdate(mdctx, args[n].str.data, args[n].str.len)
+			: EVP_DigestUpdate(mdctx, num, ngx_let_itoa(num, args[n].num) - num);
+	}
+
+	return rc;
+}
+
+static ngx_int_t ngx_let_digest(ngx_let_ctx_t *ctx, ngx_let_digest_t *d,
+		ngx_uint_t enc, ngx_let_value_t *args, ngx_uint_t nargs, 
+		ngx_let_value_t *ret)
+{
+	EVP_MD_CTX *mdctx;
+	u_char md[EVP_MAX_MD_SIZE];
+	unsigned len;
+
+	if (ngx_let_digest_md(ctx->log, d) == NULL)
+		return NGX_ERROR;
+
+	mdctx = ngx_let_md_ctx();
+	if (mdctx == NULL)
+		return NGX_ERROR;
+
+	if (!EVP_DigestInit_ex(mdctx, d->md, NULL)
+			|| !ngx_let_digest_update(mdctx, args, nargs)
+			|| !EVP_DigestFinal_ex(mdctx, md, &len)) 
+	{
+		ngx_log_error(NGX_LOG_ALERT, ctx->log, 0, 
+				"let digest \"%s\" failed", d->name);
+		return NGX_ERROR;
+	}
+
+	return ngx_let_digest_output(ctx, md, len, enc, ret);
+}
+
+#define NGX_LET_HASHFUNC_ENC(name, digest, enc) \
+static ngx_int_t ngx_let_func_##name(ngx_let_ctx_t *ctx, \
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data, \
+		ngx_let_value_t *ret) \
+{ \
+	return ngx_let_digest(ctx, &digest, enc, args, nargs, ret); \
+}
+
+#define NGX_LET_HASHFUNC(dname, name) \
+static ngx_let_digest_t ngx_let_digest_##name = { dname, NULL }; \
+	NGX_LET_HASHFUNC_ENC(name, ngx_let_digest_##name, NGX_LET_ENC_HEX) \
+	NGX_LET_HASHFUNC_ENC(name##_raw, ngx_let_digest_##name, NGX_LET_ENC_RAW) \
+	NGX_LET_HASHFUNC_ENC(name##_b64u, ngx_let_digest_##name, NGX_LET_ENC_B64U)
+
+NGX_LET_HASHFUNC("MD4", md4)
+NGX_LET_HASHFUNC("MD5", md5)
+
+NGX_LET_HASHFUNC("SHA1",   sha1)
+NGX_LET_HASHFUNC("SHA224", sha224)
+NGX_LET_HASHFUNC("SHA256", sha256)
+NGX_LET_HASHFUNC("SHA384", sha384)
+NGX_LET_HASHFUNC("SHA512", sha512)
+
+NGX_LET_HASHFUNC("RIPEMD160", ripemd160)
+
+/* HMAC
+
+   Digest states after hashing padded key are prepared once at config
+   time if key is constant; each call then starts from their copies */
+
+#define NGX_LET_HMAC_BLOCK   128   /* largest block of supported digests */
+
+typedef struct {
+
+	EVP_MD_CTX *inner;
+
+	EVP_MD_CTX *outer;
+
+} ngx_let_hmac_t;
+
+static ngx_int_t ngx_let_hmac_init(const EVP_MD *md, u_char *key, 
+		size_t len, ngx_let_hmac_t *h)
+{
+	u_char pad[NGX_LET_HMAC_BLOCK], kmd[EVP_MAX_MD_SIZE];
+	unsigned kmdlen;
+	ngx_int_t rc;
+	size_t bs, n;
+
+	bs = EVP_MD_block_size(md);
+	if (bs > sizeof(pad))
+		return NGX_ERROR;
+
+	rc = NGX_ERROR;
+
+	/* long keys are hashed */
+	if (len > bs) {
+
+		if (!EVP_Digest(key, len, kmd, &kmdlen, md, NULL))
+			goto done;
+
+		key = kmd;
+		len = kmdlen;
+	}
+
+	ngx_memzero(pad, bs);
+	ngx_memcpy(pad, key, len);
+
+	for(n = 0; n < bs; ++n)
+		pad[n] ^= 0x36;
+
+	if (!EVP_DigestInit_ex(h->inner, md, NULL)
+			|| !EVP_DigestUpdate(h->inner, pad, bs))
+		goto done;
+
+	for(n = 0; n < bs; ++n)
+		pad[n] ^= 0x36 ^ 0x5c;
+
+	if (!EVP_DigestInit_ex(h->outer, md, NULL)
+			|| !EVP_DigestUpdate(h->outer, pad, bs))
+		goto done;
+
+	rc = NGX_OK;
+
+done:
+
+	/* key material is not left on stack */
+	ngx_explicit_memzero(pad, sizeof(pad));
+	ngx_explicit_memzero(kmd, sizeof(kmd));
+
+	return rc;
+}
+
+static void ngx_let_hmac_cleanup(void *data)
+{
+	ngx_let_hmac_t *h = data;
+
+	EVP_MD_CTX_free(h->inner);
+	EVP_MD_CTX_free(h->outer);
+}
+
+static char* ngx_let_hmac_prepare(ngx_conf_t *cf, ngx_let_digest_t *d,
+		ngx_let_value_t *key, void **data)
+{
+	ngx_pool_cleanup_t *cln;
+	ngx_let_hmac_t *h;
+
+	if (ngx_let_digest_md(cf->log, d) == NULL)
+		return NGX_CONF_ERROR;
+
+	/* key is known per request only */
+	if (key->flags == 0)
+		return NGX_CONF_OK;
+
+	cln = ngx_pool_cleanup_add(cf->pool, sizeof(ngx_let_hmac_t));
+	if (cln == NULL)
+		return NGX_CONF_ERROR;
+
+	h = cln->data;
+
+	h->inner = EVP_MD_CTX_new();
+	h->outer = EVP_MD_CTX_new();
+
+	cln->handler = ngx_let_hmac_cleanup;
+
+	if (h->inner == NULL || h->outer == NULL
+			|| ngx_let_hmac_init(d->md, key->str.data, key->str.len, h) 
+				!= NGX_OK)
+	{
+		return "has invalid hmac key";
+	}
+
+	*data = h;
+
+	return NGX_CONF_OK;
+}
+
+static ngx_int_t ngx_let_hmac(ngx_let_ctx_t *ctx, ngx_let_digest_t *d,
+		ngx_uint_t enc, ngx_let_value_t *args, ngx_uint_t nargs, 
+		ngx_let_hmac_t *h, ngx_let_value_t *ret)
+{
+	static ngx_let_hmac_t tmp;
+	EVP_MD_CTX *mdctx;
+	u_char md[EVP_MAX_MD_SIZE];
+	unsigned len;
+
+	mdctx = ngx_let_md_ctx();
+	if (mdctx == NULL)
+		return NGX_ERROR;
+
+	if (h) {
+
+		if (!EVP_MD_CTX_copy_ex(mdctx, h->inner))
+			goto failed;
+
+	} else {
+
+		/* variable key; states are prepared in place */
+		if (tmp.inner == NULL) {
+
+			tmp.inner = mdctx;
+			tmp.outer = EVP_MD_CTX_new();
+			if (tmp.outer == NULL)
+				return NGX_ERROR;
+		}
+
+		if (ngx_let_value_str(ctx, &args[0]) != NGX_OK)
+			return NGX_ERROR;
+
+		if (ngx_let_hmac_init(d->md, args[0].str.data, args[0].str.len, 
+					&tmp) != NGX_OK)
+			goto failed;
+	}
+
+	if (!ngx_let_digest_update(mdctx, args + 1, nargs - 1)
+			|| !EVP_DigestFinal_ex(mdctx, md, &len))
+		goto failed;
+
+	if (h) {
+
+		if (!EVP_MD_CTX_copy_ex(mdctx, h->outer))
+			goto failed;
+
+	} else {
+
+		mdctx = tmp.outer;
+	}
+
+	if (!EVP_DigestUpdate(mdctx, md, len)
+			|| !EVP_DigestFinal_ex(mdctx, md, &len))
+		goto failed;
+
+	return ngx_let_digest_output(ctx, md, len, enc, ret);
+
+failed:
+
+	ngx_log_error(NGX_LOG_ALERT, ctx->log, 0, 
+			"let hmac \"%s\" failed", d->name);
+
+	return NGX_ERROR;
+}
+
+#define NGX_LET_HMACFUNC_ENC(name, digest, enc) \
+static ngx_int_t ngx_let_func_##name(ngx_let_ctx_t *ctx, \
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data, \
+		ngx_let_value_t *ret) \
+{ \
+	return ngx_let_hmac(ctx, &digest, enc, args, nargs, data, ret); \
+}
+
+#define NGX_LET_HMACFUNC(name) \
+static char* ngx_let_hmac_##name##_init(ngx_conf_t *cf, \
+		ngx_let_value_t *args, ngx_uint_t nargs, void **data) \
+{ \
+	return ngx_let_hmac_prepare(cf, &ngx_let_digest_##name, args, data); \
+} \
+	NGX_LET_HMACFUNC_ENC(hmac_##name, ngx_let_digest_##name, \
+			NGX_LET_ENC_HEX) \
+	NGX_LET_HMACFUNC_ENC(hmac_##name##_raw, ngx_let_digest_##name, \
+			NGX_LET_ENC_RAW) \
+	NGX_LET_HMACFUNC_ENC(hmac_##name##_b64u, ngx_let_digest_##name, \
+			NGX_LET_ENC_B64U)
+
+NGX_LET_HMACFUNC(sha1)
+NGX_LET_HMACFUNC(sha256)
+NGX_LET_HMACFUNC(sha512)
+
+/* Constant time comparison for checking tokens */
+static ngx_int_t ngx_let_func_verify(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	ngx_uint_t eq;
+
+	if (ngx_let_value_str(ctx, &args[0]) != NGX_OK
+			|| ngx_let_value_str(ctx, &args[1]) != NGX_OK)
+		return NGX_ERROR;
+
+	eq = (args[0].str.len == args[1].str.len
+			&& CRYPTO_memcmp(args[0].str.data, args[1].str.data, 
+				args[0].str.len) == 0);
+
+	ngx_let_set_int(ret, eq);
+
+	return NGX_OK;
+}
+
+/* Non-cryptographic hashes
+
+   Results are native integers for sharding with %; 64-bit hashes have
+   top bit cleared so they are never negative */
+
+#if (NGX_HAVE_LITTLE_ENDIAN)
+
+#define ngx_let_read32(p, v) ngx_memcpy(&(v), p, 4)
+#define ngx_let_read64(p, v) ngx_memcpy(&(v), p, 8)
+
+#else
+
+#define ngx_let_read32(p, v) \
+	(v) = (uint32_t) (p)[0] | (uint32_t) (p)[1] << 8 \
+		| (uint32_t) (p)[2] << 16 | (uint32_t) (p)[3] << 24
+
+#define ngx_let_read64(p, v) \
+	(v) = (uint64_t) (p)[0] | (uint64_t) (p)[1] << 8 \
+		| (uint64_t) (p)[2] << 16 | (uint64_t) (p)[3] << 24 \
+		| (uint64_t) (p)[4] << 32 | (uint64_t) (p)[5] << 40 \
+		| (uint64_t) (p)[6] << 48 | (uint64_t) (p)[7] << 56
+
+#endif
+
+#define NGX_LET_XXH_P32_1    0x9E3779B1U
+#define NGX_LET_XXH_P32_2    0x85EBCA77U
+#define NGX_LET_XXH_P32_3    0xC2B2AE3DU
+
+#define NGX_LET_XXH_P64_1    0x9E3779B185EBCA87ULL
+#define NGX_LET_XXH_P64_2    0xC2B2AE3D27D4EB4FULL
+#define NGX_LET_XXH_P64_3    0x165667B19E3779F9ULL
+#define NGX_LET_XXH_P64_4    0x85EBCA77C2B2AE63ULL
+#define NGX_LET_XXH_P64_5    0x27D4EB2F165667C5ULL
+
+static ngx_inline uint64_t ngx_let_xxh64_round(uint64_t acc, uint64_t in)
+{
+	acc += in * NGX_LET_XXH_P64_2;
+	acc = ngx_let_rotl64(acc, 31);
+
+	return acc * NGX_LET_XXH_P64_1;
+}
+
+static ngx_inline uint64_t ngx_let_xxh64_avalanche(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= NGX_LET_XXH_P64_2;
+	h ^= h >> 29;
+	h *= NGX_LET_XXH_P64_3;
+	h ^= h >> 32;
+
+	return h;
+}
+
+static uint64_t ngx_let_xxh64(u_char *p, size_t len)
+{
+	uint64_t h, v[4], k;
+	uint32_t k32;
+	u_char *last;
+	ngx_uint_t n;
+
+	last = p + len;
+
+	if (len >= 32) {
+
+		v[0] = NGX_LET_XXH_P64_1 + NGX_LET_XXH_P64_2;
+		v[1] = NGX_LET_XXH_P64_2;
+		v[2] = 0;
+		v[3] = - NGX_LET_XXH_P64_1;
+
+		for(; last - p >= 32; p += 32) {
+
+			for(n = 0; n < 4; ++n) {
+				ngx_let_read64(p + n * 8, k);
+				v[n] = ngx_let_xxh64_round(v[n], k);
+			}
+		}
+
+		h = ngx_let_rotl64(v[0], 1) + ngx_let_rotl64(v[1], 7)
+			+ ngx_let_rotl64(v[2], 12) + ngx_let_rotl64(v[3], 18);
+
+		for(n = 0; n < 4; ++n) {
+			h ^= ngx_let_xxh64_round(0, v[n]);
+			h = h * NGX_LET_XXH_P64_1 + NGX_LET_XXH_P64_4;
+		}
+
+	} else {
+
+		h = NGX_LET_XXH_P64_5;
+	}
+
+	h += len;
+
+	for(; last - p >= 8; p += 8) {
+		ngx_let_read64(p, k);
+		h ^= ngx_let_xxh64_round(0, k);
+		h = ngx_let_rotl64(h, 27) * NGX_LET_XXH_P64_1 + NGX_LET_XXH_P64_4;
+	}
+
+	if (last - p >= 4) {
+		ngx_let_read32(p, k32);
+		h ^= k32 * NGX_LET_XXH_P64_1;
+		h = ngx_let_rotl64(h, 23) * NGX_LET_XXH_P64_2 + NGX_LET_XXH_P64_3;
+		p += 4;
+	}
+
+	for(; p != last; ++p) {
+		h ^= *p * NGX_LET_XXH_P64_5;
+		h = ngx_let_rotl64(h, 11) * NGX_LET_XXH_P64_1;
+	}
+
+	return ngx_let_xxh64_avalanche(h);
+}
+
+/* XXH3 64-bit with default secret and zero seed */
+
+static u_char ngx_let_xxh3_secret[192] = {
+	0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c,
+	0xf7, 0x21, 0xad, 0x1c, 0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb,
+	0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f, 0xcb, 0x79, 0xe6, 0x4e,
+	0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+	0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6,
+	0x81, 0x3a, 0x26, 0x4c, 0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb,
+	0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3, 0x71, 0x64, 0x48, 0x97,
+	0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+	0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7,
+	0xc7, 0x0b, 0x4f, 0x1d, 0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31,
+	0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64, 0xea, 0xc5, 0xac, 0x83,
+	0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+	0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26,
+	0x29, 0xd4, 0x68, 0x9e, 0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc,
+	0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce, 0x45, 0xcb, 0x3a, 0x8f,
+	0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e
+};
+
+static ngx_inline uint64_t ngx_let_bswap64(uint64_t x)
+{
+	x = (x >> 32) | (x << 32);
+	x = ((x & 0xffff0000ffff0000ULL) >> 16) | ((x & 0x0000ffff0000ffffULL) << 16);
+
+	return ((x & 0xff00ff00ff00ff00ULL) >> 8) | ((x & 0x00ff00ff00ff00ffULL) << 8);
+}
+
+/* low ^ high half of 128-bit product */
+static ngx_inline uint64_t ngx_let_mul128_fold64(uint64_t a, uint64_t b)
+{
+#if (defined __SIZEOF_INT128__)
+	__uint128_t r;
+
+	r = (__uint128_t) a * b;
+
+	return (uint64_t) r ^ (uint64_t) (r >> 64);
+#else
+	uint64_t lo_lo, hi_lo, lo_hi, hi_hi, cross, lo, hi;
+
+	lo_lo = (a & 0xffffffff) * (b & 0xffffffff);
+	hi_lo = (a >> 32) * (b & 0xffffffff);
+	lo_hi = (a & 0xffffffff) * (b >> 32);
+	hi_hi = (a >> 32) * (b >> 32);
+
+	cross = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+	hi = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+	lo = (cross << 32) | (lo_lo & 0xffffffff);
+
+	return lo ^ hi;
+#endif
+}
+
+static ngx_inline uint64_t ngx_let_xxh3_avalanche(uint64_t h)
+{
+	h ^= h >> 37;
+	h *= 0x165667919E3779F9ULL;
+	h ^= h >> 32;
+
+	return h;
+}
+
+static ngx_inline uint64_t ngx_let_xxh3_mix16(u_char *p, u_char *s)
+{
+	uint64_t lo, hi, klo, khi;
+
+	ngx_let_read64(p, lo);
+	ngx_let_read64(p + 8, hi);
+	ngx_let_read64(s, klo);
+	ngx_let_read64(s + 8, khi);
+
+	return ngx_let_mul128_fold64(lo ^ klo, hi ^ khi);
+}
+
+static uint64_t ngx_let_xxh3_short(u_char *p, size_t len)
+{
+	u_char *s = ngx_let_xxh3_secret;
+	uint64_t lo, hi, k1, k2, h;
+	uint32_t in1, in2;
+
+	if (len > 8) {
+
+		ngx_let_read64(s + 24, k1);
+		ngx_let_read64(s + 32, k2);
+		ngx_let_read64(p, lo);
+		lo ^= k1 ^ k2;
+
+		ngx_let_read64(s + 40, k1);
+		ngx_let_read64(s + 48, k2);
+		ngx_let_read64(p + len - 8, hi);
+		hi ^= k1 ^ k2;
+
+		return ngx_let_xxh3_avalanche(len + ngx_let_bswap64(lo) + hi 
+				+ ngx_let_mul128_fold64(lo, hi));
+	}
+
+	if (len >= 4) {
+
+		ngx_let_read32(p, in1);
+		ngx_let_read32(p + len - 4, in2);
+		ngx_let_read64(s + 8, k1);
+		ngx_let_read64(s + 16, k2);
+
+		h = (in2 + ((uint64_t) in1 << 32)) ^ (k1 ^ k2);
+
+		/* rrmxmx */
+		h ^= ngx_let_rotl64(h, 49) ^ ngx_let_rotl64(h, 24);
+		h *= 0x9FB21C651E98DF25ULL;
+		h ^= (h >> 35) + len;
+		h *= 0x9FB21C651E98DF25ULL;
+
+		return h ^ (h >> 28);
+	}
+
+	if (len) {
+
+		ngx_let_read32(s, in1);
+		ngx_let_read32(s + 4, in2);
+
+		h = ((uint32_t) p[0] << 16 | (uint32_t) p[len >> 1] << 24 
+				| (uint32_t) p[len - 1] | (uint32_t) len << 8);
+
+		return ngx_let_xxh64_avalanche(h ^ (in1 ^ in2));
+	}
+
+	ngx_let_read64(s + 56, k1);
+	ngx_let_read64(s + 64, k2);
+
+	return ngx_let_xxh64_avalanche(k1 ^ k2);
+}
+
+/* 512-bit stripe into 8 accumulators */
+static ngx_inline void ngx_let_xxh3_accumulate(uint64_t *acc, u_char *p,
+		u_char *s)
+{
+	uint64_t v, k;
+	ngx_uint_t n;
+
+	for(n = 0; n < 8; ++n) {
+
+		ngx_let_read64(p + n * 8, v);
+		ngx_let_read64(s + n * 8, k);
+
+		k ^= v;
+
+		acc[n ^ 1] += v;
+		acc[n] += (k & 0xffffffff) * (k >> 32);
+	}
+}
+
+static uint64_t ngx_let_xxh3_long(u_char *p, size_t len)
+{
+	u_char *s = ngx_let_xxh3_secret;
+	uint64_t acc[8], k, k2, h;
+	size_t nblocks, nstripes, b, n;
+
+	acc[0] = NGX_LET_XXH_P32_3;
+	acc[1] = NGX_LET_XXH_P64_1;
+	acc[2] = NGX_LET_XXH_P64_2;
+	acc[3] = NGX_LET_XXH_P64_3;
+	acc[4] = NGX_LET_XXH_P64_4;
+	acc[5] = NGX_LET_XXH_P32_2;
+	acc[6] = NGX_LET_XXH_P64_5;
+	acc[7] = NGX_LET_XXH_P32_1;
+
+	/* 16 stripes of 64 bytes per block with 192-byte secret */
+	nblocks = (len - 1) / 1024;
+
+	for(b = 0; b < nblocks; ++b) {
+
+		for(n = 0; n < 16; ++n)
+			ngx_let_xxh3_accumulate(acc, p + b * 1024 + n * 64, s + n * 8);
+
+		/* scramble */
+		for(n = 0; n < 8; ++n) {
+			ngx_let_read64(s + 128 + n * 8, k);
+			acc[n] = (acc[n] ^ (acc[n] >> 47) ^ k) * NGX_LET_XXH_P32_1;
+		}
+	}
+
+	nstripes = ((len - 1) - nblocks * 1024) / 64;
+
+	for(n = 0; n < nstripes; ++n)
+		ngx_let_xxh3_accumulate(acc, p + nblocks * 1024 + n * 64, s + n * 8);
+
+	ngx_let_xxh3_accumulate(acc, p + len - 64, s + 192 - 64 - 7);
+
+	/* merge */
+	h = len * NGX_LET_XXH_P64_1;
+
+	for(n = 0; n < 4; ++n) {
+
+		ngx_let_read64(s + 11 + 16 * n, k);
+		ngx_let_read64(s + 11 + 16 * n + 8, k2);
+
+		h += ngx_let_mul128_fold64(acc[2 * n] ^ k, acc[2 * n + 1] ^ k2);
+	}
+
+	return ngx_let_xxh3_avalanche(h);
+}
+
+static uint64_t ngx_let_xxh3(u_char *p, size_t len)
+{
+	u_char *s = ngx_let_xxh3_secret;
+	uint64_t acc, end;
+	ngx_uint_t n;
+
+	if (len <= 16)
+		return ngx_let_xxh3_short(p, len);
+
+	acc = len * NGX_LET_XXH_P64_1;
+
+	if (len <= 128) {
+
+		/* pairs from both ends */
+		for(n = (len - 1) / 32 + 1; n--; ) {
+			acc += ngx_let_xxh3_mix16(p + 16 * n, s + 32 * n);
+			acc += ngx_let_xxh3_mix16(p + len - 16 * (n + 1), s + 32 * n + 16);
+		}
+
+		return ngx_let_xxh3_avalanche(acc);
+	}
+
+	if (len <= 240) {
+
+		for(n = 0; n < 8; ++n)
+			acc += ngx_let_xxh3_mix16(p + 16 * n, s + 16 * n);
+
+		acc = ngx_let_xxh3_avalanche(acc);
+		end = ngx_let_xxh3_mix16(p + len - 16, s + 136 - 17);
+
+		for(n = 8; n < len / 16; ++n)
+			end += ngx_let_xxh3_mix16(p + 16 * n, s + 16 * (n - 8) + 3);
+
+		return ngx_let_xxh3_avalanche(acc + end);
+	}
+
+	return ngx_let_xxh3_long(p, len);
+}
+
+/* MurmurHash3 x86 32-bit with zero seed */
+static uint32_t ngx_let_murmur3(u_char *p, size_t len)
+{
+	uint32_t h, k;
+	u_char *last;
+
+	h = 0;
+	last = p + (len & ~3);
+
+	for(; p != last; p += 4) {
+
+		ngx_let_read32(p, k);
+
+		k *= 0xcc9e2d51;
+		k = ngx_let_rotl32(k, 15);
+		k *= 0x1b873593;
+
+		h ^= k;
+		h = ngx_let_rotl32(h, 13);
+		h = h * 5 + 0xe6546b64;
+	}
+
+	k = 0;
+
+	switch (len & 3) {
+
+		case 3:
+			k ^= (uint32_t) p[2] << 16;
+			/* fall through */
+
+		case 2:
+			k ^= (uint32_t) p[1] << 8;
+			/* fall through */
+
+		case 1:
+			k ^= p[0];
+			k *= 0xcc9e2d51;
+			k = ngx_let_rotl32(k, 15);
+			k *= 0x1b873593;
+			h ^= k;
+	}
+
+	h ^= len;
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35;
+	h ^= h >> 16;
+
+	return h;
+}
+
+/* SipHash-2-4 */
+
+#define ngx_let_sipround(v0, v1, v2, v3) \
+	v0 += v1; v1 = ngx_let_rotl64(v1, 13); v1 ^= v0; \
+	v0 = ngx_let_rotl64(v0, 32); \
+	v2 += v3; v3 = ngx_let_rotl64(v3, 16); v3 ^= v2; \
+	v0 += v3; v3 = ngx_let_rotl64(v3, 21); v3 ^= v0; \
+	v2 += v1; v1 = ngx_let_rotl64(v1, 17); v1 ^= v2; \
+	v2 = ngx_let_rotl64(v2, 32)
+
+static uint64_t ngx_let_siphash(uint64_t *key, u_char *p, size_t len)
+{
+	uint64_t v0, v1, v2, v3, m;
+	u_char *last;
+	ngx_uint_t n;
+
+	v0 = key[0] ^ 0x736f6d6570736575ULL;
+	v1 = key[1] ^ 0x646f72616e646f6dULL;
+	v2 = key[0] ^ 0x6c7967656e657261ULL;
+	v3 = key[1] ^ 0x7465646279746573ULL;
+
+	last = p + (len & ~7);
+
+	for(; p != last; p += 8) {
+
+		ngx_let_read64(p, m);
+
+		v3 ^= m;
+		ngx_let_sipround(v0, v1, v2, v3);
+		ngx_let_sipround(v0, v1, v2, v3);
+		v0 ^= m;
+	}
+
+	m = (uint64_t) len << 56;
+
+	for(n = 0; n < (len & 7); ++n)
+		m |= (uint64_t) p[n] << (8 * n);
+
+	v3 ^= m;
+	ngx_let_sipround(v0, v1, v2, v3);
+	ngx_let_sipround(v0, v1, v2, v3);
+	v0 ^= m;
+
+	v2 ^= 0xff;
+
+	for(n = 0; n < 4; ++n) {
+		ngx_let_sipround(v0, v1, v2, v3);
+	}
+
+	return v0 ^ v1 ^ v2 ^ v3;
+}
+
+/* CRC32C (Castagnoli); SSE 4.2 instruction is used if supported */
+
+typedef uint32_t (*ngx_let_crc32c_pt)(u_char *p, size_t len);
+
+static uint32_t ngx_let_crc32c_table[256];
+
+static uint32_t ngx_let_crc32c_scalar(u_char *p, size_t len)
+{
+	uint32_t crc, c;
+	ngx_uint_t n, k;
+
+	if (ngx_let_crc32c_table[1] == 0) {
+
+		for(n = 0; n < 256; ++n) {
+
+			for(c = n, k = 0; k < 8; ++k)
+				c = (c & 1) ? (c >> 1) ^ 0x82f63b78 : c >> 1;
+
+			ngx_let_crc32c_table[n] = c;
+		}
+	}
+
+	crc = 0xffffffff;
+
+	while (len--)
+		crc = ngx_let_crc32c_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+	return crc ^ 0xffffffff;
+}
+
+#if (NGX_LET_HAVE_X86_SIMD)
+
+__attribute__((target("sse4.2")))
+static uint32_t ngx_let_crc32c_sse42(u_char *p, size_t len)
+{
+	uint64_t crc, v;
+
+	crc = 0xffffffff;
+
+	for(; len >= 8; len -= 8, p += 8) {
+		ngx_memcpy(&v, p, 8);
+		crc = _mm_crc32_u64(crc, v);
+	}
+
+	while (len--)
+		crc = _mm_crc32_u8((uint32_t) crc, *p++);
+
+	return (uint32_t) crc ^ 0xffffffff;
+}
+
+#endif
+
+static ngx_let_crc32c_pt ngx_let_crc32c = ngx_let_crc32c_scalar;
+
+#define NGX_LET_INTHASHFUNC(name, expr) \
+static ngx_int_t ngx_let_func_##name(ngx_let_ctx_t *ctx, \
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data, \
+		ngx_let_value_t *ret) \
+{ \
+	if (ngx_let_value_str(ctx, &args[0]) != NGX_OK) \
+		return NGX_ERROR; \
+\
+	ngx_let_set_int(ret, (expr)); \
+\
+	return NGX_OK; \
+}
+
+NGX_LET_INTHASHFUNC(xxh64, 
+		ngx_let_xxh64(args[0].str.data, args[0].str.len) & INT64_MAX)
+NGX_LET_INTHASHFUNC(xxh3, 
+		ngx_let_xxh3(args[0].str.data, args[0].str.len) & INT64_MAX)
+NGX_LET_INTHASHFUNC(murmur3, 
+		ngx_let_murmur3(args[0].str.data, args[0].str.len))
+NGX_LET_INTHASHFUNC(crc32c, 
+		ngx_let_crc32c(args[0].str.data, args[0].str.len))
+
+/* siphash( key s ); 16-byte key is known at config time */
+static ngx_int_t ngx_let_func_siphash(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	if (ngx_let_value_str(ctx, &args[1]) != NGX_OK)
+		return NGX_ERROR;
+
+	ngx_let_set_int(ret, ngx_let_siphash(data, args[1].str.data, 
+				args[1].str.len) & INT64_MAX);
+
+	return NGX_OK;
+}
+
+static char* ngx_let_func_siphash_init(ngx_conf_t *cf, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void **data)
+{
+	uint64_t *key;
+
+	if (args[0].flags == 0 || args[0].str.len != 16)
+		return "requires constant 16-byte siphash key";
+
+	key = ngx_palloc(cf->pool, 2 * sizeof(uint64_t));
+	if (key == NULL)
+		return NGX_CONF_ERROR;
+
+	ngx_let_read64(args[0].str.data, key[0]);
+	ngx_let_read64(args[0].str.data + 8, key[1]);
+
+	*data = key;
+
+	return NGX_CONF_OK;
+}
+
+static ngx_int_t ngx_let_func_length(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	if (ngx_let_value_str(ctx, &args[0]) != NGX_OK)
+		return NGX_ERROR;
+
+	ngx_let_set_int(ret, args[0].str.len);
+
+	return NGX_OK;
+}
+
+#define NGX_LET_ICMPFUNC(name, op) \
+static ngx_int_t ngx_let_func_##name(ngx_let_ctx_t *ctx, \
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data, \
+		ngx_let_value_t *ret) \
+{ \
+	int64_t v1, v2; \
+\
+	if (ngx_let_value_int(ctx, &args[0]) != NGX_OK \
+			|| ngx_let_value_int(ctx, &args[1]) != NGX_OK) \
+		return NGX_ERROR; \
+\
+	v1 = args[0].num; \
+	v2 = args[1].num; \
+\
+	ngx_let_set_int(ret, v1 op v2 ? v1 : v2); \
+\
+	return NGX_OK; \
+}
+
+NGX_LET_ICMPFUNC(min, <)
+NGX_LET_ICMPFUNC(max, >)
+
+/* Consistent hashing
+
+   Keys are integers; other strings are hashed with xxh3 */
+
+static uint64_t ngx_let_value_key(ngx_let_value_t *v)
+{
+	if (!(v->flags & NGX_LET_VALUE_INT)
+			&& ngx_let_toi(&v->str, &v->num) == NGX_OK)
+	{
+		v->flags |= NGX_LET_VALUE_INT;
+	}
+
+	return (v->flags & NGX_LET_VALUE_INT) 
+		? (uint64_t) v->num : ngx_let_xxh3(v->str.data, v->str.len);
+}
+
+/* jumphash( key buckets ); only 1/n keys move when bucket is added */
+static ngx_int_t ngx_let_func_jumphash(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	uint64_t key;
+	int64_t b, j, n;
+
+	if (ngx_let_value_int(ctx, &args[1]) != NGX_OK)
+		return NGX_ERROR;
+
+	key = ngx_let_value_key(&args[0]);
+
+	if (args[1].num < 1) {
+		ngx_log_error(NGX_LOG_ALERT, ctx->log, 0, 
+				"let jumphash needs positive number of buckets");
+		return NGX_ERROR;
+	}
+
+	/* as in reference implementation; next candidate then always fits
+	   int64 before it is compared */
+	n = ngx_min(args[1].num, INT32_MAX);
+
+	for(b = -1, j = 0; j < n; ) {
+		b = j;
+		key = key * 2862933555777941757ULL + 1;
+		j = (b + 1) * ((double) (1LL << 31) / (double) ((key >> 33) + 1));
+	}
+
+	ngx_let_set_int(ret, b);
+
+	return NGX_OK;
+}
+
+/* split( key w1 w2 ... ); bucket index with probabilities proportional
+   to constant weights. Key hash is scaled to sum of weights and looked
+   up in cumulative table prepared at config time */
+typedef struct {
+
+	uint64_t *cum;        /* padded to power of 2 with UINT64_MAX */
+
+	ngx_uint_t size;
+
+	uint64_t total;
+
+} ngx_let_split_t;
+
+static ngx_int_t ngx_let_func_split(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	ngx_let_split_t *sp = data;
+	uint64_t x, *base;
+	ngx_uint_t n, half;
+
+	if (ngx_let_value_str(ctx, &args[0]) != NGX_OK)
+		return NGX_ERROR;
+
+	x = ngx_let_xxh3(args[0].str.data, args[0].str.len);
+
+	/* high half of x * total is uniform in [0, total) */
+#if (defined __SIZEOF_INT128__)
+	x = (uint64_t) (((__uint128_t) x * sp->total) >> 64);
+#else
+	x %= sp->total;
+#endif
+
+	/* branch-free search for number of entries not above x */
+	for(base = sp->cum, n = sp->size; n > 1; n -= half) {
+		half = n / 2;
+		base = (base[half - 1] <= x) ? base + half : base;
+	}
+
+	ngx_let_set_int(ret, (base - sp->cum) + (*base <= x));
+
+	return NGX_OK;
+}
+
+static char* ngx_let_func_split_init(ngx_conf_t *cf, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void **data)
+{
+	ngx_let_split_t *sp;
+	ngx_uint_t n;
+
+	sp = ngx_palloc(cf->pool, sizeof(ngx_let_split_t));
+	if (sp == NULL)
+		return NGX_CONF_ERROR;
+
+	for(sp->size = 1; sp->size < nargs - 1; sp->size <<= 1);
+
+	sp->cum = ngx_palloc(cf->pool, sp->size * sizeof(uint64_t));
+	if (sp->cum == NULL)
+		return NGX_CONF_ERROR;
+
+	sp->total = 0;
+
+	for(n = 1; n < nargs; ++n) {
+
+		if (!(args[n].flags & NGX_LET_VALUE_INT) || args[n].num < 0)
+			return "requires constant non-negative split weights";
+
+		if (sp->total + args[n].num < sp->total)
+			return "has too large split weights";
+
+		sp->total += args[n].num;
+		sp->cum[n - 1] = sp->total;
+	}
+
+	if (sp->total == 0)
+		return "requires positive split weight";
+
+	for(n = nargs - 1; n < sp->size; ++n)
+		sp->cum[n] = UINT64_MAX;
+
+	*data = sp;
+
+	return NGX_CONF_OK;
+}
+
+/* rendezvous( key w1 w2 ... ); index of bucket with highest weighted
+   score w / -ln(u) where u is uniform hash of key and bucket */
+static ngx_int_t ngx_let_func_rendezvous(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	uint64_t key, h;
+	double score, best;
+	ngx_int_t found;
+	ngx_uint_t n;
+
+	key = ngx_let_value_key(&args[0]);
+	found = -1;
+	best = 0;
+
+	for(n = 1; n < nargs; ++n) {
+
+		if (ngx_let_value_int(ctx, &args[n]) != NGX_OK)
+			return NGX_ERROR;
+
+		if (args[n].num <= 0)
+			continue;
+
+		/* splitmix64 finalizer */
+		h = key + n * 0x9E3779B97F4A7C15ULL;
+		h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+		h ^= h >> 31;
+
+		score = args[n].num / -log(((h >> 11) + 0.5) / 9007199254740992.0);
+
+		if (score > best) {
+			best = score;
+			found = n - 1;
+		}
+	}
+
+	if (found == -1) {
+		ngx_log_error(NGX_LOG_ALERT, ctx->log, 0, 
+				"let rendezvous needs positive weight");
+		return NGX_ERROR;
+	}
+
+	ngx_let_set_int(ret, found);
+
+	return NGX_OK;
+}
+
+static ngx_int_t ngx_let_func_substr(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	int64_t offs, len;
+
+	if (ngx_let_value_str(ctx, &args[0]) != NGX_OK
+			|| ngx_let_value_int(ctx, &args[1]) != NGX_OK
+			|| ngx_let_value_int(ctx, &args[2]) != NGX_OK)
+		return NGX_ERROR;
+
+	offs = args[1].num;
+	len = args[2].num;
+
+	ret->flags = NGX_LET_VALUE_STR;
+	ret->str = args[0].str;
+
+	if (offs < 0 || len < 0) {
+		ngx_log_error(NGX_LOG_ALERT, ctx->log, 0, 
+				"let substr negative argument");
+		return NGX_ERROR;
+	}
+
+	if (offs >= (int64_t)ret->str.len) {
+		ret->str.len = 0;
+		return NGX_OK;
+	}
+
+	ret->str.data += offs;
+
+	if (!len || offs + len >= (int64_t)ret->str.len)
+		ret->str.len -= offs;
+	else
+		ret->str.len = len;
+
+	return NGX_OK;
+}
+
+/* String search
+
+   Candidates are found by comparing two bytes of needle at 16 or 32
+   positions at once; only they are compared in full. Second byte is
+   last one unless needle is constant: then it is chosen when loading
+   config to differ from first one, so needles like "aaab" do not turn
+   every position into candidate. Kernel is selected when module is
+   initialized. */
+
+typedef u_char* (*ngx_let_find_pt)(u_char *s, size_t n, u_char *needle,
+		size_t m, size_t o);
+
+/* needle length is at least 2; o is offset of second byte compared */
+static u_char* ngx_let_find_scalar(u_char *s, size_t n, u_char *needle,
+		size_t m, size_t o)
+{
+	u_char *p, *last;
+
+	last = s + n - m + 1;
+
+	for(p = s; p < last; ++p) {
+
+		p = memchr(p, needle[0], last - p);
+		if (p == NULL)
+			return NULL;
+
+		if (p[o] == needle[o] && ngx_memcmp(p + 1, needle + 1, m - 1) == 0)
+			return p;
+	}
+
+	return NULL;
+}
+
+#if (NGX_LET_HAVE_X86_SIMD)
+
+static u_char* ngx_let_find_sse2(u_char *s, size_t n, u_char *needle,
+		size_t m, size_t o)
+{
+	__m128i first, second, a, b;
+	unsigned mask, bit;
+	size_t i;
+
+	first = _mm_set1_epi8((char) needle[0]);
+	second = _mm_set1_epi8((char) needle[o]);
+
+	/* all candidates of block fit in s */
+	for(i = 0; i + m - 1 + 16 <= n; i += 16) {
+
+		a = _mm_loadu_si128((__m128i*) (s + i));
+		b = _mm_loadu_si128((__m128i*) (s + i + o));
+
+		mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), 
+					_mm_cmpeq_epi8(b, second)));
+
+		for(; mask; mask &= mask - 1) {
+
+			bit = __builtin_ctz(mask);
+
+			if (ngx_memcmp(s + i + bit + 1, needle + 1, m - 1) == 0)
+				return s + i + bit;
+		}
+	}
+
+	return ngx_let_find_scalar(s + i, n - i, needle, m, o);
+}
+
+__attribute__((target("avx2")))
+static u_char* ngx_let_find_avx2(u_char *s, size_t n, u_char *needle,
+		size_t m, size_t o)
+{
+	__m256i first, second, a, b;
+	unsigned mask, bit;
+	size_t i;
+
+	first = _mm256_set1_epi8((char) needle[0]);
+	second = _mm256_set1_epi8((char) needle[o]);
+
+	for(i = 0; i + m - 1 + 32 <= n; i += 32) {
+
+		a = _mm256_loadu_si256((__m256i*) (s + i));
+		b = _mm256_loadu_si256((__m256i*) (s + i + o));
+
+		mask = _mm256_movemask_epi8(_mm256_and_si256(
+					_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, second)));
+
+		for(; mask; mask &= mask - 1) {
+
+			bit = __builtin_ctz(mask);
+
+			if (ngx_memcmp(s + i + bit + 1, needle + 1, m - 1) == 0)
+				return s + i + bit;
+		}
+	}
+
+	return ngx_let_find_scalar(s + i, n - i, needle, m, o);
+}
+
+#endif
+
+static ngx_let_find_pt ngx_let_find_kernel = ngx_let_find_scalar;
+
+/* data is offset of second byte prepared for constant needle */
+static u_char* ngx_let_find(ngx_str_t *s, ngx_str_t *needle, void *data)
+{
+	if (needle->len > s->len)
+		return NULL;
+
+	if (needle->len == 0)
+		return s->data;
+
+	if (needle->len == 1)
+		return memchr(s->data, needle->data[0], s->len);
+
+	return ngx_let_find_kernel(s->data, s->len, needle->data, needle->len,
+			data ? *(size_t*) data : needle->len - 1);
+}
+
+static char* ngx_let_func_find_init(ngx_conf_t *cf, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void **data)
+{
+	ngx_str_t *needle;
+	size_t *o;
+
+	needle = &args[1].str;
+
+	if (args[1].flags == 0 || needle->len < 2)
+		return NGX_CONF_OK;
+
+	o = ngx_palloc(cf->pool, sizeof(size_t));
+	if (o == NULL)
+		return NGX_CONF_ERROR;
+
+	for(*o = needle->len - 1; 
+			*o > 1 && needle->data[*o] == needle->data[0]; --*o);
+
+	*data = o;
+
+	return NGX_CONF_OK;
+}
+
+#define NGX_LET_STRFUNC(name, expr) \
+static ngx_int_t ngx_let_func_##name(ngx_let_ctx_t *ctx, \
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data, \
+		ngx_let_value_t *ret) \
+{ \
+	ngx_str_t *s, *t; \
+	u_char *p; \
+\
+	if (ngx_let_value_str(ctx, &args[0]) != NGX_OK \
+			|| ngx_let_value_str(ctx, &args[1]) != NGX_OK) \
+		return NGX_ERROR; \
+\
+	s = &args[0].str; \
+	t = &args[1].str; \
+\
+	ngx_let_set_int(ret, (expr)); \
+\
+	(void) p; \
+\
+	return NGX_OK; \
+}
+
+/* contains( s needle ) index( s needle ); index is -1 if not found */
+NGX_LET_STRFUNC(contains, ngx_let_find(s, t, data) != NULL)
+NGX_LET_STRFUNC(index, (p = ngx_let_find(s, t, data)) ? p - s->data : -1)
+
+NGX_LET_STRFUNC(starts_with, 
+		s->len >= t->len && ngx_memcmp(s->data, t->data, t->len) == 0)
+NGX_LET_STRFUNC(ends_with, 
+		s->len >= t->len 
+		&& ngx_memcmp(s->data + s->len - t->len, t->data, t->len) == 0)
+
+/* eq( a b ); byte-wise equality, numbers are compared as strings */
+NGX_LET_STRFUNC(eq, 
+		s->len == t->len && ngx_memcmp(s->data, t->data, s->len) == 0)
+
+/* Fields
+
+   field(), before(), after() and kv() return slices of argument
+   without copying. Single-byte delimiters are counted 16 or 32 at
+   once, so whole blocks without wanted delimiter are skipped;
+   longer ones are found with ngx_let_find(). */
+
+typedef u_char* (*ngx_let_nth_pt)(u_char *p, size_t n, u_char c, 
+		size_t k);
+
+/* k-th occurrence of c, k >= 1 */
+static u_char* ngx_let_nth_scalar(u_char *p, size_t n, u_char c, size_t k)
+{
+	u_char *last;
+
+	last = p + n;
+
+	for(;;) {
+
+		p = memchr(p, c, last - p);
+		if (p == NULL || --k == 0)
+			return p;
+
+		++p;
+	}
+}
+
+#if (NGX_LET_HAVE_X86_SIMD)
+
+static u_char* ngx_let_nth_sse2(u_char *p, size_t n, u_char c, size_t k)
+{
+	__m128i cc;
+	unsigned mask, cnt;
+	size_t i;
+
+	cc = _mm_set1_epi8((char) c);
+
+	for(i = 0; i + 16 <= n; i += 16) {
+
+		mask = _mm_movemask_epi8(_mm_cmpeq_epi8(
+					_mm_loadu_si128((__m128i*) (p + i)), cc));
+
+		cnt = __builtin_popcount(mask);
+
+		if (cnt < k) {
+			k -= cnt;
+			continue;
+		}
+
+		while (--k)
+			mask &= mask - 1;
+
+		return p + i + __builtin_ctz(mask);
+	}
+
+	return i < n ? ngx_let_nth_scalar(p + i, n - i, c, k) : NULL;
+}
+
+__attribute__((target("avx2,popcnt")))
+static u_char* ngx_let_nth_avx2(u_char *p, size_t n, u_char c, size_t k)
+{
+	__m256i cc;
+	unsigned mask, cnt;
+	size_t i;
+
+	cc = _mm256_set1_epi8((char) c);
+
+	for(i = 0; i + 32 <= n; i += 32) {
+
+		mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(
+					_mm256_loadu_si256((__m256i*) (p + i)), cc));
+
+		cnt = __builtin_popcount(mask);
+
+		if (cnt < k) {
+			k -= cnt;
+			continue;
+		}
+
+		while (--k)
+			mask &= mask - 1;
+
+		return p + i + __builtin_ctz(mask);
+	}
+
+	return i < n ? ngx_let_nth_scalar(p + i, n - i, c, k) : NULL;
+}
+
+#endif
+
+static ngx_let_nth_pt ngx_let_nth_kernel = ngx_let_nth_scalar;
+
+/* k-th delimiter in s, k >= 1; data is prepared by ngx_let_func_find_init */
+static u_char* ngx_let_nth(ngx_str_t *s, ngx_str_t *delim, size_t k,
+		void *data)
+{
+	ngx_str_t rest;
+	u_char *p;
+
+	if (delim->len == 1)
+		return s->len ? ngx_let_nth_kernel(s->data, s->len, 
+				delim->data[0], k) : NULL;
+
+	rest = *s;
+
+	for(;;) {
+
+		p = ngx_let_find(&rest, delim, data);
+		if (p == NULL || --k == 0)
+			return p;
+
+		p += delim->len;
+		rest.len -= p - rest.data;
+		rest.data = p;
+	}
+}
+
+static ngx_int_t ngx_let_func_field(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	ngx_str_t *s, *delim;
+	u_char *p, *last;
+
+	if (ngx_let_value_str(ctx, &args[0]) != NGX_OK
+			|| ngx_let_value_str(ctx, &args[1]) != NGX_OK
+			|| ngx_let_value_int(ctx, &args[2]) != NGX_OK)
+		return NGX_ERROR;
+
+	s = &args[0].str;
+	delim = &args[1].str;
+
+	if (args[2].num < 1 || delim->len == 0) {
+		ngx_log_error(NGX_LOG_ALERT, ctx->log, 0, 
+				"let field needs positive number and delimiter");
+		return NGX_ERROR;
+	}
+
+	ret->flags = NGX_LET_VALUE_STR;
+	ret->str = *s;
+
+	if (args[2].num > 1) {
+
+		p = ngx_let_nth(s, delim, args[2].num - 1, data);
+		if (p == NULL) {
+			ret->str.len = 0;
+			return NGX_OK;
+		}
+
+		p += delim->len;
+		ret->str.len -= p - s->data;
+		ret->str.data = p;
+	}
+
+	last = ngx_let_nth(&ret->str, delim, 1, data);
+	if (last)
+		ret->str.len = last - ret->str.data;
+
+	return NGX_OK;
+}
+
+/* before( s delim ) after( s delim ); empty if delim is not found */
+static ngx_int_t ngx_let_func_before(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	u_char *p;
+
+	if (ngx_let_value_str(ctx, &args[0]) != NGX_OK
+			|| ngx_let_value_str(ctx, &args[1]) != NGX_OK)
+		return NGX_ERROR;
+
+	p = ngx_let_find(&args[0].str, &args[1].str, data);
+
+	ret->flags = NGX_LET_VALUE_STR;
+	ret->str.data = args[0].str.data;
+	ret->str.len = p ? (size_t) (p - args[0].str.data) : 0;
+
+	return NGX_OK;
+}
+
+static ngx_int_t ngx_let_func_after(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	ngx_str_t *s;
+	u_char *p;
+
+	if (ngx_let_value_str(ctx, &args[0]) != NGX_OK
+			|| ngx_let_value_str(ctx, &args[1]) != NGX_OK)
+		return NGX_ERROR;
+
+	s = &args[0].str;
+
+	p = ngx_let_find(s, &args[1].str, data);
+
+	ret->flags = NGX_LET_VALUE_STR;
+	ret->str.len = 0;
+	ret->str.data = s->data;
+
+	if (p) {
+		ret->str.data = p + args[1].str.len;
+		ret->str.len = s->data + s->len - ret->str.data;
+	}
+
+	return NGX_OK;
+}
+
+/* trim( s ); spaces, tabs and line ends are removed from both ends */
+static ngx_int_t ngx_let_func_trim(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	u_char *p, *last;
+
+	if (ngx_let_value_str(ctx, &args[0]) != NGX_OK)
+		return NGX_ERROR;
+
+	p = args[0].str.data;
+	last = p + args[0].str.len;
+
+	while (p < last && (*p == ' ' || *p == '\t' || *p == CR || *p == LF))
+		++p;
+
+	while (last > p && (last[-1] == ' ' || last[-1] == '\t' 
+				|| last[-1] == CR || last[-1] == LF))
+		--last;
+
+	ret->flags = NGX_LET_VALUE_STR;
+	ret->str.data = p;
+	ret->str.len = last - p;
+
+	return NGX_OK;
+}
+
+/* kv( s name [sep [eq]] ); value of first name in pairs like a=1&b=2,
+   spaces before names are skipped so that cookies can be parsed with
+   sep "; " or ";" */
+static ngx_int_t ngx_let_func_kv(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	static ngx_str_t amp = ngx_string("&");
+	static ngx_str_t equal = ngx_string("=");
+
+	ngx_str_t rest, *name, *sep, *eq;
+	u_char *p, *end;
+	ngx_uint_t n;
+
+	for(n = 0; n < nargs; ++n) {
+		if (ngx_let_value_str(ctx, &args[n]) != NGX_OK)
+			return NGX_ERROR;
+	}
+
+	name = &args[1].str;
+	sep = nargs > 2 ? &args[2].str : &amp;
+	eq = nargs > 3 ? &args[3].str : &equal;
+
+	if (sep->len == 0 || eq->len == 0) {
+		ngx_log_error(NGX_LOG_ALERT, ctx->log, 0, 
+				"let kv needs non-empty separators");
+		return NGX_ERROR;
+	}
+
+	ret->flags = NGX_LET_VALUE_STR;
+	ret->str.len = 0;
+	ret->str.data = args[0].str.data;
+
+	rest = args[0].str;
+
+	while (rest.len) {
+
+		end = ngx_let_nth(&rest, sep, 1, NULL);
+		if (end == NULL)
+			end = rest.data + rest.len;
+
+		for(p = rest.data; p < end && (*p == ' ' || *p == '\t'); ++p);
+
+		if ((size_t) (end - p) >= name->len + eq->len
+				&& ngx_memcmp(p, name->data, name->len) == 0
+				&& ngx_memcmp(p + name->len, eq->data, eq->len) == 0)
+		{
+			ret->str.data = p + name->len + eq->len;
+			ret->str.len = end - ret->str.data;
+			return NGX_OK;
+		}
+
+		if (end == rest.data + rest.len)
+			break;
+
+		end += sep->len;
+		rest.len -= end - rest.data;
+		rest.data = end;
+	}
+
+	return NGX_OK;
+}
+
+/* Case conversion and encodings
+
+   Input is scanned first: if nothing needs changing, it is returned
+   as is, otherwise result is allocated with exact size and written
+   in one more pass. Case conversion and URL escaping look at 32
+   bytes at once with AVX2. */
+
+typedef size_t (*ngx_let_case_scan_pt)(u_char *s, size_t n, u_char lo, 
+		u_char hi);
+typedef void (*ngx_let_case_copy_pt)(u_char *dst, u_char *src, size_t n,
+		u_char lo, u_char hi);
+typedef size_t (*ngx_let_uri_count_pt)(u_char *s, size_t n);
+
+/* offset of first byte in lo..hi, n if none */
+static size_t ngx_let_case_scan_scalar(u_char *s, size_t n, u_char lo, 
+		u_char hi)
+{
+	size_t i;
+
+	for(i = 0; i < n && (s[i] < lo || s[i] > hi); ++i);
+
+	return i;
+}
+
+/* bytes in lo..hi are copied with case bit flipped */
+static void ngx_let_case_copy_scalar(u_char *dst, u_char *src, size_t n,
+		u_char lo, u_char hi)
+{
+	while (n--) {
+		*dst++ = *src ^ (*src >= lo && *src <= hi ? 0x20 : 0);
+		++src;
+	}
+}
+
+#define ngx_let_uri_plain(c) \
+	((((c) | 0x20) >= 'a' && ((c) | 0x20) <= 'z') \
+	 || ((c) >= '0' && (c) <= '9') \
+	 || (c) == '-' || (c) == '.' || (c) == '_' || (c) == '~')
+
+/* number of bytes to be escaped */
+static size_t ngx_let_uri_count_scalar(u_char *s, size_t n)
+{
+	size_t k;
+
+	for(k = 0; n--; ++s) {
+		if (!ngx_let_uri_plain(*s))
+			++k;
+	}
+
+	return k;
+}
+
+#if (NGX_LET_HAVE_X86_SIMD)
+
+/* bytes >= 0x80 are negative and never match ASCII range */
+#define ngx_let_in_range256(v, lo, hi) \
+	_mm256_and_si256(_mm256_cmpgt_epi8(v, lo), _mm256_cmpgt_epi8(hi, v))
+
+__attribute__((target("avx2")))
+static size_t ngx_let_case_scan_avx2(u_char *s, size_t n, u_char lo, 
+		u_char hi)
+{
+	__m256i l, h, v;
+	unsigned mask;
+	size_t i;
+
+	l = _mm256_set1_epi8((char) (lo - 1));
+	h = _mm256_set1_epi8((char) (hi + 1));
+
+	for(i = 0; i + 32 <= n; i += 32) {
+
+		v = _mm256_loadu_si256((__m256i*) (s + i));
+
+		mask = _mm256_movemask_epi8(ngx_let_in_range256(v, l, h));
+		if (mask)
+			return i + __builtin_ctz(mask);
+	}
+
+	return i + ngx_let_case_scan_scalar(s + i, n - i, lo, hi);
+}
+
+__attribute__((target("avx2")))
+static void ngx_let_case_copy_avx2(u_char *dst, u_char *src, size_t n,
+		u_char lo, u_char hi)
+{
+	__m256i l, h, bit, v;
+
+	l = _mm256_set1_epi8((char) (lo - 1));
+	h = _mm256_set1_epi8((char) (hi + 1));
+	bit = _mm256_set1_epi8(0x20);
+
+	for(; n >= 32; n -= 32, src += 32, dst += 32) {
+
+		v = _mm256_loadu_si256((__m256i*) src);
+
+		_mm256_storeu_si256((__m256i*) dst, _mm256_xor_si256(v, 
+					_mm256_and_si256(ngx_let_in_range256(v, l, h), bit)));
+	}
+
+	ngx_let_case_copy_scalar(dst, src, n, lo, hi);
+}
+
+__attribute__((target("avx2,popcnt")))
+static size_t ngx_let_uri_count_avx2(u_char *s, size_t n)
+{
+	__m256i v, plain;
+	size_t i, k;
+
+	k = 0;
+
+	for(i = 0; i + 32 <= n; i += 32) {
+
+		v = _mm256_loadu_si256((__m256i*) (s + i));
+
+		plain = _mm256_or_si256(
+			ngx_let_in_range256(_mm256_or_si256(v, _mm256_set1_epi8(0x20)),
+				_mm256_set1_epi8('a' - 1), _mm256_set1_epi8('z' + 1)),
+			ngx_let_in_range256(v, 
+				_mm256_set1_epi8('0' - 1), _mm256_set1_epi8('9' + 1)));
+
+		plain = _mm256_or_si256(plain, _mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('-')),
+				_mm256_cmpeq_epi8(v, _mm256_set1_epi8('.'))),
+			_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')),
+				_mm256_cmpeq_epi8(v, _mm256_set1_epi8('~')))));
+
+		k += 32 - __builtin_popcount(_mm256_movemask_epi8(plain));
+	}
+
+	return k + ngx_let_uri_count_scalar(s + i, n - i);
+}
+
+#endif
+
+static ngx_let_case_scan_pt ngx_let_case_scan = ngx_let_case_scan_scalar;
+static ngx_let_case_copy_pt ngx_let_case_copy = ngx_let_case_copy_scalar;
+static ngx_let_uri_count_pt ngx_let_uri_count = ngx_let_uri_count_scalar;
+
+static ngx_int_t ngx_let_convert_case(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_let_value_t *ret, u_char lo, u_char hi)
+{
+	ngx_str_t *s;
+	size_t offs;
+
+	if (ngx_let_value_str(ctx, &args[0]) != NGX_OK)
+		return NGX_ERROR;
+
+	s = &args[0].str;
+
+	ret->flags = NGX_LET_VALUE_STR;
+	ret->str = *s;
+
+	offs = ngx_let_case_scan(s->data, s->len, lo, hi);
+	if (offs == s->len)
+		return NGX_OK;
+
+	ret->str.data = ngx_pnalloc(ctx->pool, s->len);
+	if (ret->str.data == NULL)
+		return NGX_ERROR;
+
+	ngx_memcpy(ret->str.data, s->data, offs);
+
+	ngx_let_case_copy(ret->str.data + offs, s->data + offs, s->len - offs,
+			lo, hi);
+
+	return NGX_OK;
+}
+
+static ngx_int_t ngx_let_func_lower(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	return ngx_let_convert_case(ctx, args, ret, 'A', 'Z');
+}
+
+static ngx_int_t ngx_let_func_upper(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	return ngx_let_convert_case(ctx, args, ret, 'a', 'z');
+}
+
+/* urlencode( s ); all but unreserved characters of RFC 3986 are escaped */
+static ngx_int_t ngx_let_func_urlencode(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	static u_char hex[] = "0123456789ABCDEF";
+
+	ngx_str_t *s;
+	u_char *p, *dst, *last;
+	size_t k;
+
+	if (ngx_let_value_str(ctx, &args[0]) != NGX_OK)
+		return NGX_ERROR;
+
+	s = &args[0].str;
+
+	ret->flags = NGX_LET_VALUE_STR;
+	ret->str = *s;
+
+	k = ngx_let_uri_count(s->data, s->len);
+	if (k == 0)
+		return NGX_OK;
+
+	ret->str.len = s->len + 2 * k;
+	ret->str.data = ngx_pnalloc(ctx->pool, ret->str.len);
+	if (ret->str.data == NULL)
+		return NGX_ERROR;
+
+	dst = ret->str.data;
+	last = s->data + s->len;
+
+	for(p = s->data; p < last; ++p) {
+
+		if (ngx_let_uri_plain(*p)) {
+			*dst++ = *p;
+			continue;
+		}
+
+		*dst++ = '%';
+		*dst++ = hex[*p >> 4];
+		*dst++ = hex[*p & 0x0f];
+	}
+
+	return NGX_OK;
+}
+
+static ngx_int_t ngx_let_hex_value(u_char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+
+	c |= 0x20;
+
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+
+	return -1;
+}
+
+#define ngx_let_uri_escape(p, last) \
+	((p) + 2 < (last) && ngx_let_hex_value((p)[1]) >= 0 \
+	 && ngx_let_hex_value((p)[2]) >= 0)
+
+/* urldecode( s ); %XX sequences are decoded, anything else including
+   invalid escapes and '+' is kept */
+static ngx_int_t ngx_let_func_urldecode(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	ngx_str_t *s;
+	u_char *p, *q, *dst, *last;
+	size_t k;
+
+	if (ngx_let_value_str(ctx, &args[0]) != NGX_OK)
+		return NGX_ERROR;
+
+	s = &args[0].str;
+	last = s->data + s->len;
+
+	ret->flags = NGX_LET_VALUE_STR;
+	ret->str = *s;
+
+	for(k = 0, p = s->data; (p = memchr(p, '%', last - p)); ) {
+
+		if (ngx_let_uri_escape(p, last)) {
+			++k;
+			p += 3;
+
+		} else {
+			++p;
+		}
+	}
+
+	if (k == 0)
+		return NGX_OK;
+
+	ret->str.len = s->len - 2 * k;
+	ret->str.data = ngx_pnalloc(ctx->pool, ret->str.len);
+	if (ret->str.data == NULL)
+		return NGX_ERROR;
+
+	dst = ret->str.data;
+
+	for(p = s->data; (q = memchr(p, '%', last - p)); ) {
+
+		dst = ngx_cpymem(dst, p, q - p);
+
+		if (ngx_let_uri_escape(q, last)) {
+			*dst++ = (u_char) (ngx_let_hex_value(q[1]) << 4 
+					| ngx_let_hex_value(q[2]));
+			p = q + 3;
+
+		} else {
+			*dst++ = '%';
+			p = q + 1;
+		}
+	}
+
+	ngx_memcpy(dst, p, last - p);
+
+	return NGX_OK;
+}
+
+static ngx_int_t ngx_let_func_b64enc(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	if (ngx_let_value_str(ctx, &args[0]) != NGX_OK)
+		return NGX_ERROR;
+
+	ret->flags = NGX_LET_VALUE_STR;
+	ret->str.len = ngx_base64_encoded_length(args[0].str.len);
+
+	ret->str.data = ngx_pnalloc(ctx->pool, ret->str.len);
+	if (ret->str.data == NULL)
+		return NGX_ERROR;
+
+	ngx_encode_base64(&ret->str, &args[0].str);
+
+	return NGX_OK;
+}
+
+/* b64dec( s ); padding is optional, invalid input gives empty string */
+static ngx_int_t ngx_let_func_b64dec(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	ngx_str_t src;
+
+	if (ngx_let_value_str(ctx, &args[0]) != NGX_OK)
+		return NGX_ERROR;
+
+	src = args[0].str;
+
+	while (src.len && src.data[src.len - 1] == '=')
+		--src.len;
+
+	ret->flags = NGX_LET_VALUE_STR;
+	ret->str.len = src.len * 3 / 4;
+
+	ret->str.data = ngx_pnalloc(ctx->pool, ret->str.len);
+	if (ret->str.data == NULL)
+		return NGX_ERROR;
+
+	if (ngx_decode_base64(&ret->str, &src) != NGX_OK)
+		ret->str.len = 0;
+
+	return NGX_OK;
+}
+
+/* UTF-8
+
+   Strings are validated and their characters counted in one pass.
+   AVX2 version classifies bytes with nibble lookups (Keiser and
+   Lemire) and skips blocks of ASCII. Strings that are not valid UTF-8
+   are handled as bytes, so ulength() and usubstr() then work as
+   length() and substr(). */
+
+typedef ngx_int_t (*ngx_let_utf8_length_pt)(u_char *p, size_t n);
+typedef u_char* (*ngx_let_utf8_nth_pt)(u_char *p, size_t n, size_t k);
+
+#define ngx_let_utf8_cont(c) (((c) & 0xc0) == 0x80)
+
+/* number of characters, NGX_ERROR if not valid */
+static ngx_int_t ngx_let_utf8_length_scalar(u_char *p, size_t n)
+{
+	u_char *last;
+	ngx_int_t k;
+	uint32_t c;
+	size_t len, size;
+
+	last = p + n;
+
+	for(k = 0; p < last; ++k) {
+
+		if (*p < 0x80) {
+			++p;
+			continue;
+		}
+
+		if (*p >= 0xc2 && *p <= 0xdf) {
+			len = 2;
+			c = *p & 0x1f;
+
+		} else if (*p >= 0xe0 && *p <= 0xef) {
+			len = 3;
+			c = *p & 0x0f;
+
+		} else if (*p >= 0xf0 && *p <= 0xf4) {
+			len = 4;
+			c = *p & 0x07;
+
+		} else {
+			return NGX_ERROR;
+		}
+
+		if ((size_t) (last - p) < len)
+			return NGX_ERROR;
+
+		size = len;
+
+		for(++p; --len; ++p) {
+
+			if (!ngx_let_utf8_cont(*p))
+				return NGX_ERROR;
+
+			c = (c << 6) | (*p & 0x3f);
+		}
+
+		/* overlong forms, surrogates and values above U+10FFFF */
+		if ((size == 3 && c < 0x800) || (size == 4 && c < 0x10000)
+				|| (c >= 0xd800 && c <= 0xdfff) || c > 0x10ffff)
+			return NGX_ERROR;
+	}
+
+	return k;
+}
+
+/* k-th character, k >= 1 */
+static u_char* ngx_let_utf8_nth_scalar(u_char *p, size_t n, size_t k)
+{
+	u_char *last;
+
+	for(last = p + n; p < last; ++p) {
+		if (!ngx_let_utf8_cont(*p) && --k == 0)
+			return p;
+	}
+
+	return NULL;
+}
+
+#if (NGX_LET_HAVE_X86_SIMD)
+
+#define NGX_LET_UTF8_TOO_SHORT   0x01
+#define NGX_LET_UTF8_TOO_LONG    0x02
+#define NGX_LET_UTF8_OVERLONG_3  0x04
+#define NGX_LET_UTF8_TOO_LARGE   0x08
+#define NGX_LET_UTF8_SURROGATE   0x10
+#define NGX_LET_UTF8_OVERLONG_2  0x20
+#define NGX_LET_UTF8_TOO_LARGE_1000 0x40
+#define NGX_LET_UTF8_OVERLONG_4  0x40
+#define NGX_LET_UTF8_TWO_CONTS   0x80
+#define NGX_LET_UTF8_CARRY       (NGX_LET_UTF8_TOO_SHORT \
+		| NGX_LET_UTF8_TOO_LONG | NGX_LET_UTF8_TWO_CONTS)
+
+/* previous n bytes of two adjacent blocks */
+#define ngx_let_utf8_prev(v, prev, n) \
+	_mm256_alignr_epi8(v, _mm256_permute2x128_si256(prev, v, 0x21), 16 - n)
+
+__attribute__((target("avx2")))
+static __m256i ngx_let_utf8_check_avx2(__m256i v, __m256i prev)
+{
+	__m256i prev1, hi1, lo1, hi2, nib, must23;
+
+	static const uint8_t high1[16] = {
+		/* ASCII */
+		NGX_LET_UTF8_TOO_LONG, NGX_LET_UTF8_TOO_LONG,
+		NGX_LET_UTF8_TOO_LONG, NGX_LET_UTF8_TOO_LONG,
+		NGX_LET_UTF8_TOO_LONG, NGX_LET_UTF8_TOO_LONG,
+		NGX_LET_UTF8_TOO_LONG, NGX_LET_UTF8_TOO_LONG,
+		/* continuation */
+		NGX_LET_UTF8_TWO_CONTS, NGX_LET_UTF8_TWO_CONTS,
+		NGX_LET_UTF8_TWO_CONTS, NGX_LET_UTF8_TWO_CONTS,
+		/* 110_ lead */
+		NGX_LET_UTF8_TOO_SHORT | NGX_LET_UTF8_OVERLONG_2,
+		NGX_LET_UTF8_TOO_SHORT,
+		/* 1110 lead */
+		NGX_LET_UTF8_TOO_SHORT | NGX_LET_UTF8_OVERLONG_3 
+			| NGX_LET_UTF8_SURROGATE,
+		/* 1111 lead */
+		NGX_LET_UTF8_TOO_SHORT | NGX_LET_UTF8_TOO_LARGE 
+			| NGX_LET_UTF8_TOO_LARGE_1000 | NGX_LET_UTF8_OVERLONG_4
+	};
+
+	static const uint8_t low1[16] = {
+		NGX_LET_UTF8_CARRY | NGX_LET_UTF8_OVERLONG_3 
+			| NGX_LET_UTF8_OVERLONG_2 | NGX_LET_UTF8_OVERLONG_4,
+		NGX_LET_UTF8_CARRY | NGX_LET_UTF8_OVERLONG_2,
+		NGX_LET_UTF8_CARRY,
+		NGX_LET_UTF8_CARRY,
+		NGX_LET_UTF8_CARRY | NGX_LET_UTF8_TOO_LARGE,
+		NGX_LET_UTF8_CARRY | NGX_LET_UTF8_TOO_LARGE 
+			| NGX_LET_UTF8_TOO_LARGE_1000,
+		NGX_LET_UTF8_CARRY | NGX_LET_UTF8_TOO_LARGE 
+			| NGX_LET_UTF8_TOO_LARGE_1000,
+		NGX_LET_UTF8_CARRY | NGX_LET_UTF8_TOO_LARGE 
+			| NGX_LET_UTF8_TOO_LARGE_1000,
+		NGX_LET_UTF8_CARRY | NGX_LET_UTF8_TOO_LARGE 
+			| NGX_LET_UTF8_TOO_LARGE_1000,
+		NGX_LET_UTF8_CARRY | NGX_LET_UTF8_TOO_LARGE 
+			| NGX_LET_UTF8_TOO_LARGE_1000,
+		NGX_LET_UTF8_CARRY | NGX_LET_UTF8_TOO_LARGE 
+			| NGX_LET_UTF8_TOO_LARGE_1000,
+		NGX_LET_UTF8_CARRY | NGX_LET_UTF8_TOO_LARGE 
+			| NGX_LET_UTF8_TOO_LARGE_1000,
+		NGX_LET_UTF8_CARRY | NGX_LET_UTF8_TOO_LARGE 
+			| NGX_LET_UTF8_TOO_LARGE_1000,
+		NGX_LET_UTF8_CARRY | NGX_LET_UTF8_TOO_LARGE 
+			| NGX_LET_UTF8_TOO_LARGE_1000 | NGX_LET_UTF8_SURROGATE,
+		NGX_LET_UTF8_CARRY | NGX_LET_UTF8_TOO_LARGE 
+			| NGX_LET_UTF8_TOO_LARGE_1000,
+		NGX_LET_UTF8_CARRY | NGX_LET_UTF8_TOO_LARGE 
+			| NGX_LET_UTF8_TOO_LARGE_1000
+	};
+
+	static const uint8_t high2[16] = {
+		/* ASCII */
+		NGX_LET_UTF8_TOO_SHORT, NGX_LET_UTF8_TOO_SHORT,
+		NGX_LET_UTF8_TOO_SHORT, NGX_LET_UTF8_TOO_SHORT,
+		NGX_LET_UTF8_TOO_SHORT, NGX_LET_UTF8_TOO_SHORT,
+		NGX_LET_UTF8_TOO_SHORT, NGX_LET_UTF8_TOO_SHORT,
+		/* 1000 */
+		NGX_LET_UTF8_TOO_LONG | NGX_LET_UTF8_OVERLONG_2 
+			| NGX_LET_UTF8_TWO_CONTS | NGX_LET_UTF8_OVERLONG_3 
+			| NGX_LET_UTF8_TOO_LARGE_1000 | NGX_LET_UTF8_OVERLONG_4,
+		/* 1001 */
+		NGX_LET_UTF8_TOO_LONG | NGX_LET_UTF8_OVERLONG_2 
+			| NGX_LET_UTF8_TWO_CONTS | NGX_LET_UTF8_OVERLONG_3 
+			| NGX_LET_UTF8_TOO_LARGE,
+		/* 101_ */
+		NGX_LET_UTF8_TOO_LONG | NGX_LET_UTF8_OVERLONG_2 
+			| NGX_LET_UTF8_TWO_CONTS | NGX_LET_UTF8_SURROGATE 
+			| NGX_LET_UTF8_TOO_LARGE,
+		NGX_LET_UTF8_TOO_LONG | NGX_LET_UTF8_OVERLONG_2 
+			| NGX_LET_UTF8_TWO_CONTS | NGX_LET_UTF8_SURROGATE 
+			| NGX_LET_UTF8_TOO_LARGE,
+		/* lead */
+		NGX_LET_UTF8_TOO_SHORT, NGX_LET_UTF8_TOO_SHORT,
+		NGX_LET_UTF8_TOO_SHORT, NGX_LET_UTF8_TOO_SHORT
+	};
+
+	nib = _mm256_set1_epi8(0x0f);
+
+	prev1 = ngx_let_utf8_prev(v, prev, 1);
+
+	hi1 = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(
+				_mm_loadu_si128((__m128i*) high1)),
+			_mm256_and_si256(_mm256_srli_epi16(prev1, 4), nib));
+
+	lo1 = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(
+				_mm_loadu_si128((__m128i*) low1)),
+			_mm256_and_si256(prev1, nib));
+
+	hi2 = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(
+				_mm_loadu_si128((__m128i*) high2)),
+			_mm256_and_si256(_mm256_srli_epi16(v, 4), nib));
+
+	/* third and fourth bytes of sequences must be continuations */
+	must23 = _mm256_or_si256(
+			_mm256_subs_epu8(ngx_let_utf8_prev(v, prev, 2),
+				_mm256_set1_epi8((char) (0xe0 - 0x80))),
+			_mm256_subs_epu8(ngx_let_utf8_prev(v, prev, 3),
+				_mm256_set1_epi8((char) (0xf0 - 0x80))));
+
+	return _mm256_xor_si256(
+			_mm256_and_si256(must23, _mm256_set1_epi8((char) 0x80)),
+			_mm256_and_si256(_mm256_and_si256(hi1, lo1), hi2));
+}
+
+__attribute__((target("avx2,popcnt")))
+static ngx_int_t ngx_let_utf8_length_avx2(u_char *p, size_t n)
+{
+	__m256i v, prev, err, incomplete, cont, max;
+	u_char tail[32];
+	ngx_int_t k;
+	unsigned mask;
+	size_t i;
+
+	prev = _mm256_setzero_si256();
+	err = _mm256_setzero_si256();
+	incomplete = _mm256_setzero_si256();
+
+	/* bytes of last three positions which start unfinished sequence */
+	max = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1,
+			-1, -1, -1, -1, -1, -1, -1, -1, 
+			-1, -1, -1, -1, -1, -1, -1, -1,
+			-1, -1, -1, -1, -1, 
+			(char) (0xf0 - 1), (char) (0xe0 - 1), (char) (0xc0 - 1));
+
+	cont = _mm256_set1_epi8(-65);
+
+	k = 0;
+
+	for(i = 0; i < n + 32; i += 32) {
+
+		if (i + 32 <= n) {
+			v = _mm256_loadu_si256((__m256i*) (p + i));
+			mask = 0xffffffff;
+
+		} else {
+
+			/* zero padding finishes check of last sequence */
+			ngx_memzero(tail, sizeof(tail));
+
+			if (i < n)
+				ngx_memcpy(tail, p + i, n - i);
+
+			v = _mm256_loadu_si256((__m256i*) tail);
+			mask = i < n ? (1u << (n - i)) - 1 : 0;
+		}
+
+		/* characters are bytes other than continuations */
+		k += __builtin_popcount(_mm256_movemask_epi8(
+					_mm256_cmpgt_epi8(v, cont)) & mask);
+
+		if (_mm256_movemask_epi8(v) == 0) {
+			err = _mm256_or_si256(err, incomplete);
+
+		} else {
+			err = _mm256_or_si256(err, ngx_let_utf8_check_avx2(v, prev));
+			incomplete = _mm256_subs_epu8(v, max);
+		}
+
+		prev = v;
+	}
+
+	return _mm256_testz_si256(err, err) ? k : NGX_ERROR;
+}
+
+__attribute__((target("avx2,popcnt")))
+static u_char* ngx_let_utf8_nth_avx2(u_char *p, size_t n, size_t k)
+{
+	__m256i cont;
+	unsigned mask, cnt;
+	size_t i;
+
+	cont = _mm256_set1_epi8(-65);
+
+	for(i = 0; i + 32 <= n; i += 32) {
+
+		mask = _mm256_movemask_epi8(_mm256_cmpgt_epi8(
+					_mm256_loadu_si256((__m256i*) (p + i)), cont));
+
+		cnt = __builtin_popcount(mask);
+
+		if (cnt < k) {
+			k -= cnt;
+			continue;
+		}
+
+		while (--k)
+			mask &= mask - 1;
+
+		return p + i + __builtin_ctz(mask);
+	}
+
+	return ngx_let_utf8_nth_scalar(p + i, n - i, k);
+}
+
+#endif
+
+static ngx_let_utf8_length_pt ngx_let_utf8_length = 
+	ngx_let_utf8_length_scalar;
+static ngx_let_utf8_nth_pt ngx_let_utf8_nth = ngx_let_utf8_nth_scalar;
+
+static ngx_int_t ngx_let_func_ulength(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	ngx_int_t k;
+
+	if (ngx_let_value_str(ctx, &args[0]) != NGX_OK)
+		return NGX_ERROR;
+
+	k = ngx_let_utf8_length(args[0].str.data, args[0].str.len);
+
+	ngx_let_set_int(ret, k == NGX_ERROR ? (ngx_int_t) args[0].str.len : k);
+
+	return NGX_OK;
+}
+
+/* usubstr( s offset length ); same as substr() in characters */
+static ngx_int_t ngx_let_func_usubstr(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	int64_t offs, len;
+	ngx_str_t *s;
+	ngx_int_t k;
+	u_char *p, *last;
+
+	if (ngx_let_value_str(ctx, &args[0]) != NGX_OK
+			|| ngx_let_value_int(ctx, &args[1]) != NGX_OK
+			|| ngx_let_value_int(ctx, &args[2]) != NGX_OK)
+		return NGX_ERROR;
+
+	s = &args[0].str;
+
+	k = ngx_let_utf8_length(s->data, s->len);
+
+	/* ASCII or not UTF-8 */
+	if (k == NGX_ERROR || k == (ngx_int_t) s->len)
+		return ngx_let_func_substr(ctx, args, nargs, data, ret);
+
+	offs = args[1].num;
+	len = args[2].num;
+
+	if (offs < 0 || len < 0) {
+		ngx_log_error(NGX_LOG_ALERT, ctx->log, 0, 
+				"let usubstr negative argument");
+		return NGX_ERROR;
+	}
+
+	ret->flags = NGX_LET_VALUE_STR;
+	ret->str.data = s->data;
+	ret->str.len = 0;
+
+	if (offs >= k)
+		return NGX_OK;
+
+	p = ngx_let_utf8_nth(s->data, s->len, offs + 1);
+
+	last = NULL;
+
+	if (len && offs + len < k)
+		last = ngx_let_utf8_nth(p, s->data + s->len - p, len + 1);
+
+	if (last == NULL)
+		last = s->data + s->len;
+
+	ret->str.data = p;
+	ret->str.len = last - p;
+
+	return NGX_OK;
+}
+
+/* JSON
+
+   json( s path ) finds value by dot-separated path of object keys and
+   array indexes without parsing whole document or allocating memory.
+   Input is classified 64 bytes at a time into bitmasks of quotes,
+   backslashes and structural characters; quotes escaped by odd
+   backslash sequences are removed, strings are masked out with prefix
+   XOR of quotes, and values are then found by walking remaining
+   structural characters, as done by simdjson. */
+
+#define NGX_LET_JSON_DEPTH  16
+
+typedef void (*ngx_let_json_classify_pt)(u_char *p, uint64_t *quote,
+		uint64_t *bs, uint64_t *op);
+
+typedef struct {
+
+	ngx_str_t *keys;
+
+	ngx_uint_t nkeys;
+
+} ngx_let_json_path_t;
+
+typedef struct {
+
+	u_char *base;         /* current block */
+
+	u_char *next;         /* next block */
+
+	u_char *last;
+
+	uint64_t bits;        /* structural characters left in block */
+
+	uint64_t odd_bs;      /* block ended with odd backslash sequence */
+
+	uint64_t in_string;   /* block ended inside string */
+
+} ngx_let_json_iter_t;
+
+static void ngx_let_json_classify_scalar(u_char *p, uint64_t *quote,
+		uint64_t *bs, uint64_t *op)
+{
+	ngx_uint_t n;
+
+	*quote = *bs = *op = 0;
+
+	for(n = 0; n < 64; ++n) {
+
+		switch(p[n]) {
+
+			case '"':
+				*quote |= 1ULL << n;
+				break;
+
+			case '\\':
+				*bs |= 1ULL << n;
+				break;
+
+			case '{': case '}': case '[': case ']': case ':': case ',':
+				*op |= 1ULL << n;
+		}
+	}
+}
+
+#if (NGX_LET_HAVE_X86_SIMD)
+
+#define ngx_let_json_mask256(lo, hi) \
+	((uint64_t) (uint32_t) _mm256_movemask_epi8(lo) \
+	 | (uint64_t) (uint32_t) _mm256_movemask_epi8(hi) << 32)
+
+#define ngx_let_json_eq256(v, c) \
+	_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c))
+
+__attribute__((target("avx2")))
+static void ngx_let_json_classify_avx2(u_char *p, uint64_t *quote,
+		uint64_t *bs, uint64_t *op)
+{
+	__m256i lo, hi, lop, hip, lob, hib;
+
+	lo = _mm256_loadu_si256((__m256i*) p);
+	hi = _mm256_loadu_si256((__m256i*) (p + 32));
+
+	*quote = ngx_let_json_mask256(ngx_let_json_eq256(lo, '"'),
+			ngx_let_json_eq256(hi, '"'));
+
+	*bs = ngx_let_json_mask256(ngx_let_json_eq256(lo, '\\'),
+			ngx_let_json_eq256(hi, '\\'));
+
+	/* brackets differ from braces in bit 0x20 only */
+	lob = _mm256_or_si256(lo, _mm256_set1_epi8(0x20));
+	hib = _mm256_or_si256(hi, _mm256_set1_epi8(0x20));
+
+	lop = _mm256_or_si256(
+			_mm256_or_si256(ngx_let_json_eq256(lob, '{'), 
+				ngx_let_json_eq256(lob, '}')),
+			_mm256_or_si256(ngx_let_json_eq256(lo, ':'), 
+				ngx_let_json_eq256(lo, ',')));
+
+	hip = _mm256_or_si256(
+			_mm256_or_si256(ngx_let_json_eq256(hib, '{'), 
+				ngx_let_json_eq256(hib, '}')),
+			_mm256_or_si256(ngx_let_json_eq256(hi, ':'), 
+				ngx_let_json_eq256(hi, ',')));
+
+	*op = ngx_let_json_mask256(lop, hip);
+}
+
+#endif
+
+static ngx_let_json_classify_pt ngx_let_json_classify = 
+	ngx_let_json_classify_scalar;
+
+/* characters escaped by odd backslash sequences */
+static uint64_t ngx_let_json_escaped(uint64_t bs, uint64_t *odd_bs)
+{
+	uint64_t even, odd, starts, even_starts, odd_starts, even_carries,
+			 odd_carries, ends;
+
+	even = 0x5555555555555555ULL;
+	odd = ~even;
+
+	starts = bs & ~(bs << 1);
+
+	/* sequence continuing from previous block starts at odd bit */
+	even_starts = starts & (even ^ *odd_bs);
+	odd_starts = starts & ~(even ^ *odd_bs);
+
+	even_carries = bs + even_starts;
+	odd_carries = bs + odd_starts;
+
+	ends = (odd_carries < bs);
+	odd_carries |= *odd_bs;
+	*odd_bs = ends;
+
+	return ((even_carries & ~bs) & odd) | ((odd_carries & ~bs) & even);
+}
+
+/* next structural character, NULL at end */
+static u_char* ngx_let_json_next(ngx_let_json_iter_t *it)
+{
+	uint64_t quote, bs, op, in;
+	u_char buf[64];
+	u_char *p;
+
+	while (it->bits == 0) {
+
+		if (it->next >= it->last)
+			return NULL;
+
+		p = it->base = it->next;
+		it->next += 64;
+
+		if (it->last - p < 64) {
+
+			/* spaces are not structural */
+			ngx_memset(buf, ' ', sizeof(buf));
+			ngx_memcpy(buf, p, it->last - p);
+			p = buf;
+		}
+
+		ngx_let_json_classify(p, &quote, &bs, &op);
+
+		quote &= ~ngx_let_json_escaped(bs, &it->odd_bs);
+
+		/* prefix XOR gives bits inside strings */
+		in = quote;
+		in ^= in << 1;
+		in ^= in << 2;
+		in ^= in << 4;
+		in ^= in << 8;
+		in ^= in << 16;
+		in ^= in << 32;
+		in ^= it->in_string;
+
+		it->in_string = (uint64_t) ((int64_t) in >> 63);
+
+		it->bits = (op & ~in) | quote;
+	}
+
+	p = it->base + __builtin_ctzll(it->bits);
+	it->bits &= it->bits - 1;
+
+	return p;
+}
+
+#define ngx_let_json_space(c) \
+	((c) == ' ' || (c) == '\t' || (c) == CR || (c) == LF)
+
+/* Value following structural character at prev; returns 1 for scalar
+   placed in v, 0 if value starts at *tok. In both cases *tok is next
+   structural character */
+static ngx_int_t ngx_let_json_value(ngx_let_json_iter_t *it, u_char *prev,
+		u_char **tok, ngx_str_t *v)
+{
+	u_char *p, *t, *end;
+
+	t = ngx_let_json_next(it);
+	end = t ? t : it->last;
+
+	*tok = t;
+
+	for(p = prev; p < end && ngx_let_json_space(*p); ++p);
+
+	if (p == end)
+		return 0;
+
+	while (end > p && ngx_let_json_space(end[-1]))
+		--end;
+
+	v->data = p;
+	v->len = end - p;
+
+	return 1;
+}
+
+/* end of string, object or array starting at t */
+static u_char* ngx_let_json_skip(ngx_let_json_iter_t *it, u_char *t)
+{
+	ngx_uint_t depth;
+
+	if (*t == '"') {
+		t = ngx_let_json_next(it);
+		return t ? t + 1 : NULL;
+	}
+
+	if (*t != '{' && *t != '[')
+		return NULL;
+
+	for(depth = 1; depth; ) {
+
+		t = ngx_let_json_next(it);
+		if (t == NULL)
+			return NULL;
+
+		if (*t == '{' || *t == '[')
+			++depth;
+
+		else if (*t == '}' || *t == ']')
+			--depth;
+	}
+
+	return t + 1;
+}
+
+/* skips value following prev; returns next structural character */
+static u_char* ngx_let_json_skip_value(ngx_let_json_iter_t *it, 
+		u_char *prev)
+{
+	ngx_str_t v;
+	u_char *t;
+
+	if (ngx_let_json_value(it, prev, &t, &v))
+		return t;
+
+	if (t == NULL || ngx_let_json_skip(it, t) == NULL)
+		return NULL;
+
+	return ngx_let_json_next(it);
+}
+
+/* \uXXXX escape at p */
+static ngx_int_t ngx_let_json_hex4(u_char *p, u_char *last, uint32_t *c)
+{
+	ngx_int_t d;
+	ngx_uint_t n;
+
+	if (last - p < 6 || p[0] != '\\' || p[1] != 'u')
+		return NGX_ERROR;
+
+	for(*c = 0, n = 2; n < 6; ++n) {
+
+		d = ngx_let_hex_value(p[n]);
+		if (d < 0)
+			return NGX_ERROR;
+
+		*c = (*c << 4) | d;
+	}
+
+	return NGX_OK;
+}
+
+/* Compares key as written in document with path key; escapes are
+   decoded on the fly so nothing is allocated */
+static ngx_uint_t ngx_let_json_key_equal(u_char *p, u_char *last,
+		ngx_str_t *key)
+{
+	u_char buf[4], *k, *end;
+	uint32_t c, lo;
+	size_t n;
+
+	if (memchr(p, '\\', last - p) == NULL)
+		return (size_t) (last - p) == key->len
+			&& ngx_memcmp(p, key->data, key->len) == 0;
+
+	k = key->data;
+	end = k + key->len;
+
+	while (p < last) {
+
+		if (*p != '\\') {
+
+			if (k == end || *k++ != *p++)
+				return 0;
+
+			continue;
+		}
+
+		if (last - p < 2)
+			return 0;
+
+		switch(p[1]) {
+
+			case '"': case '\\': case '/':
+				c = p[1];
+				break;
+
+			case 'b': c = '\b'; break;
+			case 'f': c = '\f'; break;
+			case 'n': c = '\n'; break;
+			case 'r': c = '\r'; break;
+			case 't': c = '\t'; break;
+
+			case 'u':
+
+				if (ngx_let_json_hex4(p, last, &c) != NGX_OK)
+					return 0;
+
+				p += 4;
+
+				/* surrogate pair */
+				if (c >= 0xd800 && c <= 0xdbff 
+						&& ngx_let_json_hex4(p + 2, last, &lo) == NGX_OK
+						&& lo >= 0xdc00 && lo <= 0xdfff)
+				{
+					c = 0x10000 + ((c - 0xd800) << 10) + (lo - 0xdc00);
+					p += 6;
+				}
+
+				break;
+
+			default:
+				return 0;
+		}
+
+		p += 2;
+
+		/* UTF-8 */
+		if (c < 0x80) {
+			buf[0] = (u_char) c;
+			n = 1;
+
+		} else if (c < 0x800) {
+			buf[0] = (u_char) (0xc0 | (c >> 6));
+			buf[1] = (u_char) (0x80 | (c & 0x3f));
+			n = 2;
+
+		} else if (c < 0x10000) {
+			buf[0] = (u_char) (0xe0 | (c >> 12));
+			buf[1] = (u_char) (0x80 | ((c >> 6) & 0x3f));
+			buf[2] = (u_char) (0x80 | (c & 0x3f));
+			n = 3;
+
+		} else {
+			buf[0] = (u_char) (0xf0 | (c >> 18));
+			buf[1] = (u_char) (0x80 | ((c >> 12) & 0x3f));
+			buf[2] = (u_char) (0x80 | ((c >> 6) & 0x3f));
+			buf[3] = (u_char) (0x80 | (c & 0x3f));
+			n = 4;
+		}
+
+		if ((size_t) (end - k) < n || ngx_memcmp(k, buf, n) != 0)
+			return 0;
+
+		k += n;
+	}
+
+	return k == end;
+}
+
+static ngx_int_t ngx_let_json_find(ngx_str_t *s, ngx_str_t *keys,
+		ngx_uint_t nkeys, ngx_str_t *out)
+{
+	ngx_let_json_iter_t it;
+	ngx_uint_t n;
+	ngx_int_t index;
+	u_char *prev, *t, *k, *end;
+
+	ngx_memzero(&it, sizeof(it));
+
+	it.next = s->data;
+	it.last = s->data + s->len;
+
+	prev = s->data;
+
+	for(n = 0; ; ++n) {
+
+		if (ngx_let_json_value(&it, prev, &t, out)) {
+
+			if (n == nkeys)
+				return NGX_OK;
+
+			return NGX_DECLINED;
+		}
+
+		if (t == NULL)
+			return NGX_DECLINED;
+
+		if (n == nkeys) {
+
+			end = ngx_let_json_skip(&it, t);
+			if (end == NULL)
+				return NGX_DECLINED;
+
+			/* strings are returned without quotes */
+			if (*t == '"') {
+				++t;
+				--end;
+			}
+
+			out->data = t;
+			out->len = end - t;
+
+			return NGX_OK;
+		}
+
+		if (*t == '{') {
+
+			for(;;) {
+
+				k = ngx_let_json_next(&it);
+				if (k == NULL || *k != '"')
+					return NGX_DECLINED;
+
+				t = ngx_let_json_next(&it);
+				prev = ngx_let_json_next(&it);
+
+				if (t == NULL || prev == NULL || *prev != ':')
+					return NGX_DECLINED;
+
+				if (ngx_let_json_key_equal(k + 1, t, &keys[n]))
+					break;
+
+				t = ngx_let_json_skip_value(&it, prev + 1);
+				if (t == NULL || *t != ',')
+					return NGX_DECLINED;
+			}
+
+		} else if (*t == '[') {
+
+			index = ngx_atoi(keys[n].data, keys[n].len);
+			if (index == NGX_ERROR)
+				return NGX_DECLINED;
+
+			for(prev = t; index--; prev = t) {
+
+				t = ngx_let_json_skip_value(&it, prev + 1);
+				if (t == NULL || *t != ',')
+					return NGX_DECLINED;
+			}
+
+		} else {
+			return NGX_DECLINED;
+		}
+
+		++prev;
+	}
+}
+
+static char* ngx_let_json_split(ngx_str_t *path, ngx_str_t *keys,
+		ngx_uint_t *nkeys)
+{
+	u_char *p, *last, *dot;
+	ngx_uint_t n;
+
+	if (path->len == 0) {
+		*nkeys = 0;
+		return NULL;
+	}
+
+	p = path->data;
+	last = p + path->len;
+
+	for(n = 0; ; ++n) {
+
+		if (n == *nkeys)
+			return "has too deep json path";
+
+		dot = memchr(p, '.', last - p);
+
+		keys[n].data = p;
+		keys[n].len = (dot ? dot : last) - p;
+
+		if (dot == NULL)
+			break;
+
+		p = dot + 1;
+	}
+
+	*nkeys = n + 1;
+
+	return NULL;
+}
+
+static ngx_int_t ngx_let_func_json(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	ngx_let_json_path_t *jp, tmp;
+	ngx_str_t keys[NGX_LET_JSON_DEPTH];
+	char *err;
+
+	if (ngx_let_value_str(ctx, &args[0]) != NGX_OK)
+		return NGX_ERROR;
+
+	jp = data;
+
+	if (jp == NULL) {
+
+		if (ngx_let_value_str(ctx, &args[1]) != NGX_OK)
+			return NGX_ERROR;
+
+		tmp.keys = keys;
+		tmp.nkeys = NGX_LET_JSON_DEPTH;
+
+		err = ngx_let_json_split(&args[1].str, keys, &tmp.nkeys);
+		if (err) {
+			ngx_log_error(NGX_LOG_ALERT, ctx->log, 0, "let json %s", err);
+			return NGX_ERROR;
+		}
+
+		jp = &tmp;
+	}
+
+	ret->flags = NGX_LET_VALUE_STR;
+
+	if (ngx_let_json_find(&args[0].str, jp->keys, jp->nkeys, &ret->str)
+			!= NGX_OK)
+	{
+		ret->str.data = args[0].str.data;
+		ret->str.len = 0;
+	}
+
+	return NGX_OK;
+}
+
+static char* ngx_let_func_json_init(ngx_conf_t *cf, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void **data)
+{
+	ngx_str_t keys[NGX_LET_JSON_DEPTH];
+	ngx_let_json_path_t *jp;
+	char *err;
+
+	/* path known per request only */
+	if (!(args[1].flags & NGX_LET_VALUE_STR))
+		return NGX_CONF_OK;
+
+	jp = ngx_palloc(cf->pool, sizeof(ngx_let_json_path_t));
+	if (jp == NULL)
+		return NGX_CONF_ERROR;
+
+	/* same limit as for paths known per request */
+	jp->nkeys = NGX_LET_JSON_DEPTH;
+
+	err = ngx_let_json_split(&args[1].str, keys, &jp->nkeys);
+	if (err)
+		return err;
+
+	jp->keys = ngx_palloc(cf->pool, 
+			ngx_max(jp->nkeys, 1) * sizeof(ngx_str_t));
+	if (jp->keys == NULL)
+		return NGX_CONF_ERROR;
+
+	ngx_memcpy(jp->keys, keys, jp->nkeys * sizeof(ngx_str_t));
+
+	*data = jp;
+
+	return NGX_CONF_OK;
+}
+
+#if (NGX_PCRE)
+
+/* Regular expressions
+
+   Patterns are constant and compiled when loading config; with
+   pcre_jit on they are JIT compiled as all other regexes. Captures go
+   to static per-worker vector, so matching allocates nothing. */
+
+#define NGX_LET_CAPTURES     10   /* \0 .. \9 */
+
+static int ngx_let_ovector[NGX_LET_CAPTURES * 3];
+
+typedef struct {
+
+	ngx_regex_t *regex;
+
+	ngx_int_t captures;
+
+	ngx_uint_t utf;       /* empty match skips whole character */
+
+	ngx_str_t sub;        /* replace() substitution */
+
+} ngx_let_regex_t;
+
+/* Same as ngx_regex_exec() but starts at offset; text before it is
+   still seen by ^, \b and lookbehind */
+static ngx_int_t ngx_let_regex_exec_at(ngx_regex_t *re, ngx_str_t *s,
+		size_t offset, int *captures, ngx_uint_t size)
+{
+#if (NGX_PCRE2)
+	static pcre2_match_data *md;
+
+	PCRE2_SIZE *ov;
+	ngx_uint_t n, i;
+	int rc;
+
+	if (md == NULL) {
+
+		md = pcre2_match_data_create(NGX_LET_CAPTURES, NULL);
+		if (md == NULL)
+			return PCRE2_ERROR_NOMEMORY;
+	}
+
+	rc = pcre2_match(re, s->data, s->len, offset, 0, md, NULL);
+	if (rc < 0)
+		return rc;
+
+	n = pcre2_get_ovector_count(md);
+	ov = pcre2_get_ovector_pointer(md);
+
+	if (n > size / 3)
+		n = size / 3;
+
+	/* PCRE2_UNSET becomes -1 */
+	for(i = 0; i < 2 * n; ++i)
+		captures[i] = (int) ov[i];
+
+	return rc;
+#else
+	return pcre_exec(re->code, re->extra, (const char *) s->data, s->len,
+			offset, 0, captures, size);
+#endif
+}
+
+/* Matches regex starting at offset; returns number of captures set,
+   0 if not matched */
+static ngx_int_t ngx_let_regex_exec(ngx_let_ctx_t *ctx, ngx_let_regex_t *lr,
+		ngx_str_t *s, size_t offset)
+{
+	ngx_int_t rc;
+
+	rc = ngx_let_regex_exec_at(lr->regex, s, offset, ngx_let_ovector, 
+			NGX_LET_CAPTURES * 3);
+
+	if (rc == NGX_REGEX_NO_MATCHED)
+		return 0;
+
+	if (rc < 0) {
+		ngx_log_error(NGX_LOG_ALERT, ctx->log, 0, 
+				ngx_regex_exec_n " failed: %i on \"%V\"", rc, s);
+		return NGX_ERROR;
+	}
+
+	/* vector is too small for all captures */
+	return rc ? rc : NGX_LET_CAPTURES;
+}
+
+/* match( s re ); 1 if s matches */
+static ngx_int_t ngx_let_func_match(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	ngx_int_t rc;
+
+	if (ngx_let_value_str(ctx, &args[0]) != NGX_OK)
+		return NGX_ERROR;
+
+	rc = ngx_let_regex_exec(ctx, data, &args[0].str, 0);
+	if (rc == NGX_ERROR)
+		return NGX_ERROR;
+
+	ngx_let_set_int(ret, rc > 0);
+
+	return NGX_OK;
+}
+
+/* extract( s re [n] ); capture n (whole match by default) as slice of
+   s, empty if not matched */
+static ngx_int_t ngx_let_func_extract(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	ngx_int_t rc, n;
+
+	n = 0;
+
+	if (nargs == 3) {
+
+		if (ngx_let_value_int(ctx, &args[2]) != NGX_OK)
+			return NGX_ERROR;
+
+		if (args[2].num < 0 || args[2].num >= NGX_LET_CAPTURES) {
+			ngx_log_error(NGX_LOG_ALERT, ctx->log, 0, 
+					"let extract invalid capture %L", args[2].num);
+			return NGX_ERROR;
+		}
+
+		n = args[2].num;
+	}
+
+	if (ngx_let_value_str(ctx, &args[0]) != NGX_OK)
+		return NGX_ERROR;
+
+	rc = ngx_let_regex_exec(ctx, data, &args[0].str, 0);
+	if (rc == NGX_ERROR)
+		return NGX_ERROR;
+
+	ret->flags = NGX_LET_VALUE_STR;
+	ret->str.data = args[0].str.data;
+	ret->str.len = 0;
+
+	if (n < rc && ngx_let_ovector[2 * n] >= 0) {
+		ret->str.data += ngx_let_ovector[2 * n];
+		ret->str.len = ngx_let_ovector[2 * n + 1] - ngx_let_ovector[2 * n];
+	}
+
+	return NGX_OK;
+}
+
+/* Writes matches of s replaced with substitution to p or only counts
+   length if p is NULL; \N in substitution is capture N. Each match is
+   searched in whole s starting after previous one */
+static ssize_t ngx_let_replace(ngx_let_ctx_t *ctx, ngx_let_regex_t *lr,
+		ngx_str_t *s, u_char *p)
+{
+	ngx_int_t rc, c;
+	size_t len, offs, done;
+	u_char *q, *last;
+	int *cap;
+
+	cap = ngx_let_ovector;
+	len = 0;
+
+	/* s is copied up to done, next match is searched from offs */
+	done = 0;
+	offs = 0;
+
+	while (offs <= s->len) {
+
+		rc = ngx_let_regex_exec(ctx, lr, s, offs);
+		if (rc == NGX_ERROR)
+			return NGX_ERROR;
+
+		if (rc == 0)
+			break;
+
+		/* text before match */
+		if (p)
+			p = ngx_cpymem(p, s->data + done, cap[0] - done);
+
+		len += cap[0] - done;
+
+		for(q = lr->sub.data, last = q + lr->sub.len; q != last; ++q) {
+
+			if (*q == '\\' && q + 1 != last 
+					&& q[1] >= '0' && q[1] <= '9')
+			{
+				c = *++q - '0';
+
+				if (c < rc && cap[2 * c] >= 0) {
+
+					if (p)
+						p = ngx_cpymem(p, s->data + cap[2 * c], 
+								cap[2 * c + 1] - cap[2 * c]);
+
+					len += cap[2 * c + 1] - cap[2 * c];
+				}
+
+				continue;
+			}
+
+			if (*q == '\\' && q + 1 != last && q[1] == '\\')
+				++q;
+
+			if (p)
+				*p++ = *q;
+
+			++len;
+		}
+
+		done = cap[1];
+		offs = cap[1];
+
+		/* empty match; next one is searched after following character
+		   which is kept */
+		if (cap[1] == cap[0]) {
+
+			++offs;
+
+			if (lr->utf) {
+				while (offs < s->len && (s->data[offs] & 0xc0) == 0x80)
+					++offs;
+			}
+		}
+	}
+
+	if (p)
+		ngx_memcpy(p, s->data + done, s->len - done);
+
+	return len + s->len - done;
+}
+
+/* replace( s re sub ); all matches are replaced */
+static ngx_int_t ngx_let_func_replace(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	ssize_t len;
+
+	if (ngx_let_value_str(ctx, &args[0]) != NGX_OK)
+		return NGX_ERROR;
+
+	/* two passes so result is allocated once with exact size */
+	len = ngx_let_replace(ctx, data, &args[0].str, NULL);
+	if (len == NGX_ERROR)
+		return NGX_ERROR;
+
+	ret->flags = NGX_LET_VALUE_STR;
+	ret->str.len = len;
+	ret->str.data = ngx_pnalloc(ctx->pool, len);
+	if (ret->str.data == NULL)
+		return NGX_ERROR;
+
+	if (ngx_let_replace(ctx, data, &args[0].str, ret->str.data) == NGX_ERROR)
+		return NGX_ERROR;
+
+	return NGX_OK;
+}
+
+static char* ngx_let_func_regex_init(ngx_conf_t *cf, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void **data)
+{
+	ngx_regex_compile_t rc;
+	ngx_let_regex_t *lr;
+	u_char errstr[NGX_MAX_CONF_ERRSTR];
+#if (NGX_PCRE2)
+	uint32_t opts;
+#else
+	unsigned long opts;
+#endif
+
+	if (args[1].flags == 0)
+		return "requires constant regular expression";
+
+	lr = ngx_pcalloc(cf->pool, sizeof(ngx_let_regex_t));
+	if (lr == NULL)
+		return NGX_CONF_ERROR;
+
+	ngx_memzero(&rc, sizeof(ngx_regex_compile_t));
+
+	rc.pattern = args[1].str;
+	rc.pool = cf->pool;
+	rc.err.len = NGX_MAX_CONF_ERRSTR;
+	rc.err.data = errstr;
+
+	if (ngx_regex_compile(&rc) != NGX_OK) {
+		ngx_conf_log_error(NGX_LOG_EMERG, cf, 0, "let %V", &rc.err);
+		return NGX_CONF_ERROR;
+	}
+
+	lr->regex = rc.regex;
+	lr->captures = rc.captures;
+
+#if (NGX_PCRE2)
+	pcre2_pattern_info(lr->regex, PCRE2_INFO_ALLOPTIONS, &opts);
+	lr->utf = (opts & PCRE2_UTF) != 0;
+#else
+	pcre_fullinfo(lr->regex->code, NULL, PCRE_INFO_OPTIONS, &opts);
+	lr->utf = (opts & PCRE_UTF8) != 0;
+#endif
+
+	*data = lr;
+
+	return NGX_CONF_OK;
+}
+
+static char* ngx_let_func_extract_init(ngx_conf_t *cf, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void **data)
+{
+	ngx_let_regex_t *lr;
+	char *rv;
+
+	rv = ngx_let_func_regex_init(cf, args, nargs, data);
+	if (rv != NGX_CONF_OK)
+		return rv;
+
+	lr = *data;
+
+	if (nargs == 3 && (args[2].flags & NGX_LET_VALUE_INT)
+			&& (args[2].num < 0 || args[2].num > lr->captures
+				|| args[2].num >= NGX_LET_CAPTURES))
+	{
+		return "has invalid capture number";
+	}
+
+	return NGX_CONF_OK;
+}
+
+static char* ngx_let_func_replace_init(ngx_conf_t *cf, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void **data)
+{
+	ngx_let_regex_t *lr;
+	char *rv;
+
+	if (args[2].flags == 0)
+		return "requires constant substitution";
+
+	rv = ngx_let_func_regex_init(cf, args, nargs, data);
+	if (rv != NGX_CONF_OK)
+		return rv;
+
+	lr = *data;
+	lr->sub = args[2].str;
+
+	return NGX_CONF_OK;
+}
+
+#endif
+
+/* Shared counters
+
+   Named 64-bit counters live in let_zone shared memory as open
+   addressing table. Slots are claimed with compare-and-swap and
+   updated with atomic fetch-add, so no lock is taken. Each slot takes
+   whole cache line so hot counters do not share it. */
+
+typedef struct {
+
+	ngx_shm_zone_t *zone;
+
+	ngx_uint_t counters;  /* counter functions are used */
+
+	ngx_shm_zone_t *cache;
+
+	ngx_uint_t cached;    /* cache() is used */
+
+} ngx_http_let_main_conf_t;
+
+/* slot states */
+#define NGX_LET_COUNTER_EMPTY  0
+#define NGX_LET_COUNTER_BUSY   1   /* name is being written */
+#define NGX_LET_COUNTER_READY  2
+
+#define NGX_LET_COUNTER_NAME   32
+#define NGX_LET_COUNTER_SPIN   2048   /* waits for BUSY slot */
+
+typedef union {
+
+	struct {
+
+		ngx_atomic_t state;
+
+		ngx_atomic_t value;   /* 32 bits on 32-bit platforms */
+
+		uint64_t key;
+
+		size_t len;
+
+		u_char name[NGX_LET_COUNTER_NAME];
+	};
+
+	u_char pad[NGX_CPU_CACHE_LINE];
+
+} ngx_let_counter_t;
+
+typedef struct {
+
+	ngx_let_counter_t *slots;
+
+	ngx_uint_t size;
+
+} ngx_let_counters_t;
+
+/* Call site of incr() or get(); slot of constant name is looked up
+   once per worker */
+typedef struct {
+
+	ngx_http_let_main_conf_t *lmcf;
+
+	uint64_t key;
+
+	ngx_let_counter_t *slot;
+
+	ngx_uint_t constant;
+
+} ngx_let_counter_site_t;
+
+static ngx_int_t ngx_http_let_init_zone(ngx_shm_zone_t *shm_zone, void *data)
+{
+	ngx_let_counters_t *counters, *ocounters = data;
+	ngx_slab_pool_t *shpool;
+	ngx_uint_t n;
+
+	if (ocounters) {
+		shm_zone->data = ocounters;
+		return NGX_OK;
+	}
+
+	shpool = (ngx_slab_pool_t *) shm_zone->shm.addr;
+
+	if (shm_zone->shm.exists) {
+		shm_zone->data = shpool->data;
+		return NGX_OK;
+	}
+
+	counters = ngx_slab_alloc(shpool, sizeof(ngx_let_counters_t));
+	if (counters == NULL)
+		return NGX_ERROR;
+
+	/* table takes all pages left after slab header */
+	n = shpool->pfree * ngx_pagesize / sizeof(ngx_let_counter_t);
+
+	for( ;; ) {
+
+		if (n == 0)
+			return NGX_ERROR;
+
+		counters->slots = ngx_slab_alloc(shpool, n * sizeof(ngx_let_counter_t));
+		if (counters->slots)
+			break;
+
+		n -= ngx_min(n, ngx_pagesize / sizeof(ngx_let_counter_t));
+	}
+
+	ngx_memzero(counters->slots, n * sizeof(ngx_let_counter_t));
+
+	counters->size = n;
+
+	shpool->data = counters;
+	shm_zone->data = counters;
+
+	ngx_log_debug1(NGX_LOG_DEBUG_CORE, shm_zone->shm.log, 0, 
+			"let zone counter slots: %ui", n);
+
+	return NGX_OK;
+}
+
+/* Finds counter slot, creates it if asked. Returns NULL if counter
+   does not exist or table is full */
+static ngx_let_counter_t* ngx_let_counter(ngx_let_counters_t *counters,
+		uint64_t key, ngx_str_t *name, ngx_uint_t create)
+{
+	ngx_let_counter_t *slot;
+	ngx_uint_t n, probes, spin;
+
+	/* table size is not power of 2 */
+	n = key % counters->size;
+
+	for(probes = 0; probes < counters->size; ++probes) {
+
+		slot = &counters->slots[n];
+
+		if (++n == counters->size)
+			n = 0;
+
+		if (slot->state == NGX_LET_COUNTER_EMPTY) {
+
+			if (!create)
+				return NULL;
+
+			if (ngx_atomic_cmp_set(&slot->state, NGX_LET_COUNTER_EMPTY,
+						NGX_LET_COUNTER_BUSY))
+			{
+				slot->key = key;
+				slot->len = name->len;
+				ngx_memcpy(slot->name, name->data, name->len);
+
+				ngx_memory_barrier();
+
+				slot->state = NGX_LET_COUNTER_READY;
+
+				return slot;
+			}
+		}
+
+		/* other worker is naming this slot; if it takes too long
+		   (e.g. worker died) slot is skipped as taken by other name */
+		for(spin = 0; spin < NGX_LET_COUNTER_SPIN
+				&& slot->state != NGX_LET_COUNTER_READY; ++spin)
+			ngx_cpu_pause();
+
+		if (slot->state != NGX_LET_COUNTER_READY)
+			continue;
+
+		ngx_memory_barrier();
+
+		if (slot->key == key && slot->len == name->len
+				&& ngx_memcmp(slot->name, name->data, name->len) == 0)
+			return slot;
+	}
+
+	return NULL;
+}
+
+static ngx_int_t ngx_let_counter_find(ngx_let_ctx_t *ctx,
+		ngx_let_counter_site_t *site, ngx_let_value_t *name,
+		ngx_uint_t create, ngx_let_counter_t **slot)
+{
+	ngx_shm_zone_t *zone;
+	uint64_t key;
+
+	if (site->slot) {
+		*slot = site->slot;
+		return NGX_OK;
+	}
+
+	if (ngx_let_value_str(ctx, name) != NGX_OK)
+		return NGX_ERROR;
+
+	if (name->str.len > NGX_LET_COUNTER_NAME) {
+		ngx_log_error(NGX_LOG_ALERT, ctx->log, 0, 
+				"let counter name \"%V\" is too long", &name->str);
+		return NGX_ERROR;
+	}
+
+	zone = site->lmcf->zone;
+
+	key = site->constant ? site->key 
+		: ngx_let_xxh3(name->str.data, name->str.len);
+
+	*slot = ngx_let_counter(zone->data, key, &name->str, create);
+
+	if (*slot == NULL && create) {
+		ngx_log_error(NGX_LOG_ALERT, ctx->log, 0, 
+				"let zone \"%V\" has no room for counter \"%V\"", 
+				&zone->shm.name, &name->str);
+		return NGX_ERROR;
+	}
+
+	if (site->constant)
+		site->slot = *slot;
+
+	return NGX_OK;
+}
+
+/* incr( name [delta] ); returns new value */
+static ngx_int_t ngx_let_func_incr(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	ngx_let_counter_t *slot;
+	int64_t delta;
+
+	delta = 1;
+
+	if (nargs == 2) {
+
+		if (ngx_let_value_int(ctx, &args[1]) != NGX_OK)
+			return NGX_ERROR;
+
+		delta = args[1].num;
+	}
+
+	if (ngx_let_counter_find(ctx, data, &args[0], 1, &slot) != NGX_OK)
+		return NGX_ERROR;
+
+	/* sign extended where atomic is narrower than 64 bits */
+	ngx_let_set_int(ret, (int64_t) (ngx_atomic_int_t) 
+			(ngx_atomic_fetch_add(&slot->value, (ngx_atomic_int_t) delta)
+			 + (ngx_atomic_int_t) delta));
+
+	return NGX_OK;
+}
+
+/* get( name ); 0 if counter does not exist */
+static ngx_int_t ngx_let_func_get(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	ngx_let_counter_t *slot;
+
+	if (ngx_let_counter_find(ctx, data, &args[0], 0, &slot) != NGX_OK)
+		return NGX_ERROR;
+
+	ngx_let_set_int(ret, slot ? (int64_t) (ngx_atomic_int_t) slot->value : 0);
+
+	return NGX_OK;
+}
+
+static char* ngx_let_func_counter_init(ngx_conf_t *cf, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void **data)
+{
+	ngx_let_counter_site_t *site;
+
+	site = ngx_pcalloc(cf->pool, sizeof(ngx_let_counter_site_t));
+	if (site == NULL)
+		return NGX_CONF_ERROR;
+
+	/* zone may be declared later; checked with main conf */
+	site->lmcf = ngx_http_conf_get_module_main_conf(cf, ngx_http_let_module);
+	site->lmcf->counters = 1;
+
+	if (args[0].flags) {
+
+		if (args[0].str.len > NGX_LET_COUNTER_NAME)
+			return "has too long counter name";
+
+		site->constant = 1;
+		site->key = ngx_let_xxh3(args[0].str.data, args[0].str.len);
+	}
+
+	*data = site;
+
+	return NGX_CONF_OK;
+}
+
+/* Shared result cache
+
+   cache( call ttl ) keeps results of pure function calls in
+   let_cache_zone so value computed by one worker is reused by others.
+   Entries are found by two independent 64-bit hashes of function name
+   and arguments in red-black tree and evicted in LRU order when zone
+   is full. */
+
+#define NGX_LET_CACHE_VALUE    4096   /* longer results are not stored */
+
+typedef struct {
+
+	ngx_rbtree_t rbtree;
+
+	ngx_rbtree_node_t sentinel;
+
+	ngx_queue_t lru;
+
+	ngx_atomic_t hits;
+
+	ngx_atomic_t misses;
+
+} ngx_let_cache_sh_t;
+
+typedef struct {
+
+	ngx_let_cache_sh_t *sh;
+
+	ngx_slab_pool_t *shpool;
+
+} ngx_let_cache_t;
+
+typedef struct {
+
+	ngx_rbtree_node_t node; /* key is first hash */
+
+	ngx_queue_t queue;
+
+	uint64_t key[2];
+
+	ngx_msec_t expires;
+
+	ngx_uint_t flags;     /* value flags */
+
+	int64_t num;
+
+	size_t len;
+
+	u_char data[1];
+
+} ngx_let_cache_node_t;
+
+/* cache() call site */
+typedef struct {
+
+	ngx_http_let_main_conf_t *lmcf;
+
+	ngx_msec_t ttl;
+
+	void *data;           /* call site data of function cached */
+
+} ngx_let_cache_site_t;
+
+static void ngx_let_cache_rbtree_insert(ngx_rbtree_node_t *temp,
+		ngx_rbtree_node_t *node, ngx_rbtree_node_t *sentinel)
+{
+	ngx_rbtree_node_t **p;
+	ngx_let_cache_node_t *cn, *cnt;
+
+	for ( ;; ) {
+
+		if (node->key != temp->key) {
+
+			p = (node->key < temp->key) ? &temp->left : &temp->right;
+
+		} else {
+
+			cn = (ngx_let_cache_node_t *) node;
+			cnt = (ngx_let_cache_node_t *) temp;
+
+			p = (cn->key[1] < cnt->key[1]) ? &temp->left : &temp->right;
+		}
+
+		if (*p == sentinel)
+			break;
+
+		temp = *p;
+	}
+
+	*p = node;
+	node->parent = temp;
+	node->left = sentinel;
+	node->right = sentinel;
+	ngx_rbt_red(node);
+}
+
+static ngx_int_t ngx_http_let_init_cache_zone(ngx_shm_zone_t *shm_zone,
+		void *data)
+{
+	ngx_let_cache_t *cache, *ocache = data;
+
+	cache = shm_zone->data;
+
+	if (ocache) {
+		cache->sh = ocache->sh;
+		cache->shpool = ocache->shpool;
+		return NGX_OK;
+	}
+
+	cache->shpool = (ngx_slab_pool_t *) shm_zone->shm.addr;
+
+	if (shm_zone->shm.exists) {
+		cache->sh = cache->shpool->data;
+		return NGX_OK;
+	}
+
+	cache->sh = ngx_slab_alloc(cache->shpool, sizeof(ngx_let_cache_sh_t));
+	if (cache->sh == NULL)
+		return NGX_ERROR;
+
+	cache->shpool->data = cache->sh;
+
+	/* full zone is normal, entries are evicted then */
+	cache->shpool->log_nomem = 0;
+
+	ngx_rbtree_init(&cache->sh->rbtree, &cache->sh->sentinel,
+			ngx_let_cache_rbtree_insert);
+
+	ngx_queue_init(&cache->sh->lru);
+
+	cache->sh->hits = 0;
+	cache->sh->misses = 0;
+
+	return NGX_OK;
+}
+
+static ngx_inline uint64_t ngx_let_cache_mix(uint64_t h, uint64_t v)
+{
+	h = (h ^ v) + 0x9E3779B97F4A7C15ULL;
+	h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+
+	return h ^ (h >> 31);
+}
+
+static void ngx_let_cache_key(ngx_let_func_t *func, ngx_let_value_t *args,
+		ngx_uint_t nargs, uint64_t *key)
+{
+	ngx_uint_t n;
+
+	key[0] = ngx_let_xxh3(func->name.data, func->name.len);
+	key[1] = ngx_let_xxh64(func->name.data, func->name.len);
+
+	for(n = 0; n < nargs; ++n) {
+
+		if (args[n].flags & NGX_LET_VALUE_STR) {
+
+			key[0] = ngx_let_cache_mix(key[0], 
+					ngx_let_xxh3(args[n].str.data, args[n].str.len));
+			key[1] = ngx_let_cache_mix(key[1] + args[n].str.len, 
+					ngx_let_xxh64(args[n].str.data, args[n].str.len));
+
+		} else {
+
+			/* native integers are never mixed with strings */
+			key[0] = ngx_let_cache_mix(~key[0], (uint64_t) args[n].num);
+			key[1] = ngx_let_cache_mix(~key[1], (uint64_t) args[n].num);
+		}
+	}
+}
+
+static ngx_let_cache_node_t* ngx_let_cache_lookup(ngx_let_cache_t *cache,
+		uint64_t *key)
+{
+	ngx_rbtree_node_t *node, *sentinel;
+	ngx_let_cache_node_t *cn;
+
+	node = cache->sh->rbtree.root;
+	sentinel = cache->sh->rbtree.sentinel;
+
+	while (node != sentinel) {
+
+		if ((ngx_rbtree_key_t) key[0] != node->key) {
+			node = ((ngx_rbtree_key_t) key[0] < node->key) 
+				? node->left : node->right;
+			continue;
+		}
+
+		cn = (ngx_let_cache_node_t *) node;
+
+		if (key[1] == cn->key[1] && key[0] == cn->key[0])
+			return cn;
+
+		node = (key[1] < cn->key[1]) ? node->left : node->right;
+	}
+
+	return NULL;
+}
+
+static void ngx_let_cache_delete(ngx_let_cache_t *cache,
+		ngx_let_cache_node_t *cn)
+{
+	ngx_queue_remove(&cn->queue);
+	ngx_rbtree_delete(&cache->sh->rbtree, &cn->node);
+	ngx_slab_free_locked(cache->shpool, cn);
+}
+
+/* Removes expired entries from LRU tail; with force removes least
+   recently used one anyway. Returns NGX_DECLINED if nothing removed */
+static ngx_int_t ngx_let_cache_expire(ngx_let_cache_t *cache,
+		ngx_uint_t force)
+{
+	ngx_let_cache_node_t *cn;
+	ngx_queue_t *q;
+	ngx_uint_t n;
+
+	for(n = 0; n < 2; ++n) {
+
+		if (ngx_queue_empty(&cache->sh->lru))
+			return n ? NGX_OK : NGX_DECLINED;
+
+		q = ngx_queue_last(&cache->sh->lru);
+		cn = ngx_queue_data(q, ngx_let_cache_node_t, queue);
+
+		if (!force && (ngx_msec_int_t) (cn->expires - ngx_current_msec) > 0)
+			return n ? NGX_OK : NGX_DECLINED;
+
+		ngx_let_cache_delete(cache, cn);
+
+		force = 0;
+	}
+
+	return NGX_OK;
+}
+
+static void ngx_let_cache_store(ngx_let_cache_t *cache, uint64_t *key,
+		ngx_msec_t ttl, ngx_let_value_t *value)
+{
+	ngx_let_cache_node_t *cn;
+	size_t size;
+
+	if (value->str.len > NGX_LET_CACHE_VALUE)
+		return;
+
+	size = offsetof(ngx_let_cache_node_t, data) + value->str.len;
+
+	ngx_shmtx_lock(&cache->shpool->mutex);
+
+	/* other worker could be faster */
+	cn = ngx_let_cache_lookup(cache, key);
+	if (cn)
+		ngx_let_cache_delete(cache, cn);
+
+	ngx_let_cache_expire(cache, 0);
+
+	cn = ngx_slab_alloc_locked(cache->shpool, size);
+
+	if (cn == NULL) {
+
+		/* evict at most few entries, value is just not cached then */
+		ngx_let_cache_expire(cache, 1);
+
+		cn = ngx_slab_alloc_locked(cache->shpool, size);
+		if (cn == NULL) {
+			ngx_shmtx_unlock(&cache->shpool->mutex);
+			return;
+		}
+	}
+
+	cn->node.key = (ngx_rbtree_key_t) key[0];
+	cn->key[0] = key[0];
+	cn->key[1] = key[1];
+	cn->expires = ngx_current_msec + ttl;
+	cn->flags = value->flags;
+	cn->num = value->num;
+	cn->len = value->str.len;
+	ngx_memcpy(cn->data, value->str.data, value->str.len);
+
+	ngx_rbtree_insert(&cache->sh->rbtree, &cn->node);
+	ngx_queue_insert_head(&cache->sh->lru, &cn->queue);
+
+	ngx_shmtx_unlock(&cache->shpool->mutex);
+}
+
+static ngx_int_t ngx_let_cached(ngx_let_ctx_t *ctx, ngx_let_func_t *func,
+		ngx_let_value_t *args, ngx_uint_t nargs, ngx_let_cache_site_t *site,
+		ngx_let_value_t *ret)
+{
+	ngx_let_cache_t *cache;
+	ngx_let_cache_node_t *cn;
+	uint64_t key[2];
+	ngx_int_t rc;
+
+	cache = site->lmcf->cache->data;
+
+	ngx_let_cache_key(func, args, nargs, key);
+
+	ngx_shmtx_lock(&cache->shpool->mutex);
+
+	cn = ngx_let_cache_lookup(cache, key);
+
+	if (cn && (ngx_msec_int_t) (cn->expires - ngx_current_msec) <= 0) {
+		ngx_let_cache_delete(cache, cn);
+		cn = NULL;
+	}
+
+	if (cn) {
+
+		ret->flags = cn->flags;
+		ret->num = cn->num;
+		ret->str.len = cn->len;
+		ret->str.data = ngx_pnalloc(ctx->pool, cn->len);
+
+		if (ret->str.data)
+			ngx_memcpy(ret->str.data, cn->data, cn->len);
+
+		ngx_queue_remove(&cn->queue);
+		ngx_queue_insert_head(&cache->sh->lru, &cn->queue);
+
+		ngx_shmtx_unlock(&cache->shpool->mutex);
+
+		(void) ngx_atomic_fetch_add(&cache->sh->hits, 1);
+
+		ngx_log_debug1(NGX_LOG_DEBUG_HTTP, ctx->log, 0, 
+				"let cache hit '%V'", &func->name);
+
+		return ret->str.data ? NGX_OK : NGX_ERROR;
+	}
+
+	ngx_shmtx_unlock(&cache->shpool->mutex);
+
+	(void) ngx_atomic_fetch_add(&cache->sh->misses, 1);
+
+	rc = func->handler(ctx, args, nargs, site->data, ret);
+	if (rc != NGX_OK)
+		return rc;
+
+	/* both forms are kept so hits convert nothing */
+	if (ngx_let_value_str(ctx, ret) != NGX_OK)
+		return NGX_ERROR;
+
+	ngx_let_cache_store(cache, key, site->ttl, ret);
+
+	return NGX_OK;
+}
+
+/* cache_hits(), cache_misses(); statistics of let_cache_zone */
+static ngx_int_t ngx_let_func_cache_hits(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	ngx_http_let_main_conf_t *lmcf = data;
+	ngx_let_cache_t *cache;
+
+	cache = lmcf->cache ? lmcf->cache->data : NULL;
+
+	ngx_let_set_int(ret, cache ? (int64_t) cache->sh->hits : 0);
+
+	return NGX_OK;
+}
+
+static ngx_int_t ngx_let_func_cache_misses(ngx_let_ctx_t *ctx, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void *data,
+		ngx_let_value_t *ret)
+{
+	ngx_http_let_main_conf_t *lmcf = data;
+	ngx_let_cache_t *cache;
+
+	cache = lmcf->cache ? lmcf->cache->data : NULL;
+
+	ngx_let_set_int(ret, cache ? (int64_t) cache->sh->misses : 0);
+
+	return NGX_OK;
+}
+
+static char* ngx_let_func_cache_stats_init(ngx_conf_t *cf, 
+		ngx_let_value_t *args, ngx_uint_t nargs, void **data)
+{
+	*data = ngx_http_conf_get_module_main_conf(cf, ngx_http_let_module);
+
+	return NGX_CONF_OK;
+}
+
+/* Per-worker memoization
+
+   Pure calls of let with memo=N keep results in table of N entries
+   owned by worker, so no locking is needed. Entry is found by hash of
+   arguments among few neighbouring slots and least recently used one
+   of them is replaced. Arguments and results are stored in entry, so
+   calls with long arguments or results are not memoized. */
+
+#define NGX_LET_MEMO_KEY     64
+#define NGX_LET_MEMO_VALUE   128
+#define NGX_LET_MEMO_WAYS    4
+#define NGX_LET_MEMO_MAX     65536   /* entries per call site */
+
+typedef struct {
+
+	uint64_t hash;
+
+	ngx_uint_t stamp;     /* last use; 0 if empty */
+
+	ngx_uint_t flags;     /* value flags */
+
+	int64_t num;
+
+	u_short klen;
+
+	u_short vlen;
+
+	u_char key[NGX_LET_MEMO_KEY];
+
+	u_char value[NGX_LET_MEMO_VALUE];
+
+} ngx_let_memo_entry_t;
+
+typedef struct {
+
+	void *data;           /* call site data of function memoized */
+
+	ngx_let_memo_entry_t *entries;
+
+	ngx_uint_t mask;
+
+	ngx_uint_t clock;
+
+} ngx_let_memo_t;
+
+/* Serializes arguments; returns 0 if they are too long */
+static size_t ngx_let_memo_key(ngx_let_value_t *args, ngx_uint_t nargs,
+		u_char *key)
+{
+	u_char *p, *last;
+	ngx_uint_t n;
+
+	p = key;
+	last = key + NGX_LET_MEMO_KEY;
+
+	for(n = 0; n < nargs; ++n) {
+
+		if (!(args[n].flags & NGX_LET_VALUE_STR)) {
+
+			if (last - p < 1 + 8)
+				return 0;
+
+			*p++ = 0xff;
+			p = ngx_cpymem(p, &args[n].num, 8);
+
+			continue;
+		}
+
+		if (args[n].str.len >= 0xff || last - p < 1 + (ssize_t) args[n].str.len)
+			return 0;
+
+		*p++ = (u_char) args[n].str.len;
+		p = ngx_cpymem(p, args[n].str.data, args[n].str.len);
+	}
+
+	return p - key;
+}
+
+static ngx_int_t ngx_let_memo_call(ngx_let_ctx_t *ctx, ngx_let_func_t *func,
+		ngx_let_value_t *args, ngx_uint_t nargs, ngx_let_memo_t *memo,
+		ngx_let_value_t *ret)
+{
+	u_char key[NGX_LET_MEMO_KEY];
+	ngx_let_memo_entry_t *e, *victim;
+	uint64_t hash;
+	size_t klen;
+	ngx_uint_t n;
+	ngx_int_t rc;
+
+	klen = ngx_let_memo_key(args, nargs, key);
+	if (klen == 0 && nargs)
+		return func->handler(ctx, args, nargs, memo->data, ret);
+
+	hash = ngx_let_xxh3(key, klen);
+	victim = NULL;
+
+	for(n = 0; n < NGX_LET_MEMO_WAYS; ++n) {
+
+		e = &memo->entries[(hash + n) & memo->mask];
+
+		if (e->stamp && e->hash == hash && e->klen == klen
+				&& ngx_memcmp(e->key, key, klen) == 0)
+		{
+			e->stamp = ++memo->clock;
+
+			ret->flags = e->flags;
+			ret->num = e->num;
+
+			/* entry may be replaced while request holds value */
+			if (e->flags & NGX_LET_VALUE_STR) {
+
+				ret->str.len = e->vlen;
+				ret->str.data = ngx_pnalloc(ctx->pool, e->vlen);
+				if (ret->str.data == NULL)
+					return NGX_ERROR;
+
+				ngx_memcpy(ret->str.data, e->value, e->vlen);
+			}
+
+			ngx_log_debug1(NGX_LOG_DEBUG_HTTP, ctx->log, 0, 
+					"let memo hit '%V'", &func->name);
+
+			return NGX_OK;
+		}
+
+		if (victim == NULL || e->stamp < victim->stamp)
+			victim = e;
+	}
+
+	rc = func->handler(ctx, args, nargs, memo->data, ret);
+	if (rc != NGX_OK)
+		return rc;
+
+	if ((ret->flags & NGX_LET_VALUE_STR) && ret->str.len > NGX_LET_MEMO_VALUE)
+		return NGX_OK;
+
+	victim->hash = hash;
+	victim->stamp = ++memo->clock;
+	victim->flags = ret->flags;
+	victim->num = ret->num;
+	victim->klen = (u_short) klen;
+	ngx_memcpy(victim->key, key, klen);
+
+	if (ret->flags & NGX_LET_VALUE_STR) {
+		victim->vlen = (u_short) ret->str.len;
+		ngx_memcpy(victim->value, ret->str.data, ret->str.len);
+	}
+
+	return NGX_OK;
+}
+
+#define ngx_let_func(nm, min, max, flags) \
+	{ ngx_string(#nm), min, max, flags, ngx_let_func_##nm, NULL }
+
+#define NGX_LET_HMACFUNC_FLAGS \
+	(NGX_LET_FUNC_PURE|NGX_LET_FUNC_CONCAT|NGX_LET_FUNC_KEY)
+
+#define ngx_let_hmacfunc(nm) \
+	{ ngx_string("hmac_" #nm), 2, NGX_LET_VARARGS, NGX_LET_HMACFUNC_FLAGS, \
+		ngx_let_func_hmac_##nm, ngx_let_hmac_##nm##_init }, \
+	{ ngx_string("hmac_" #nm "_raw"), 2, NGX_LET_VARARGS, \
+		NGX_LET_HMACFUNC_FLAGS, ngx_let_func_hmac_##nm##_raw, \
+		ngx_let_hmac_##nm##_init }, \
+	{ ngx_string("hmac_" #nm "_b64u"), 2, NGX_LET_VARARGS, \
+		NGX_LET_HMACFUNC_FLAGS, ngx_let_func_hmac_##nm##_b64u, \
+		ngx_let_hmac_##nm##_init }
+
+#define NGX_LET_HASHFUNC_FLAGS (NGX_LET_FUNC_PURE|NGX_LET_FUNC_CONCAT)
+
+#define ngx_let_hashfunc(nm) \
+	ngx_let_func(nm, 1, NGX_LET_VARARGS, NGX_LET_HASHFUNC_FLAGS), \
+	ngx_let_func(nm##_raw, 1, NGX_LET_VARARGS, NGX_LET_HASHFUNC_FLAGS), \
+	ngx_let_func(nm##_b64u, 1, NGX_LET_VARARGS, NGX_LET_HASHFUNC_FLAGS)
+
+/* Functions are bound by name when expression is compiled */
+static ngx_let_func_t ngx_let_functions[] = {
+
+	/* random numbers; never folded or shared */
+	{ ngx_string("rand"), 0, 2, 0,
+		ngx_let_func_rand, ngx_let_func_rand_init },
+	ngx_let_func(rand64, 0, 0, 0),
+
+	/* cryptographic hashes; hex, raw & base64url encoded */
+	ngx_let_hashfunc(md4),
+	ngx_let_hashfunc(md5),
+
+	ngx_let_hashfunc(sha1),
+	ngx_let_hashfunc(sha224),
+	ngx_let_hashfunc(sha256),
+	ngx_let_hashfunc(sha384),
+	ngx_let_hashfunc(sha512),
+
+	ngx_let_hashfunc(ripemd160),
+
+	/* HMAC( key message ... ) */
+	ngx_let_hmacfunc(sha1),
+	ngx_let_hmacfunc(sha256),
+	ngx_let_hmacfunc(sha512),
+
+	ngx_let_func(verify, 2, 2, NGX_LET_FUNC_PURE),
+
+	/* non-cryptographic hashes */
+	ngx_let_func(xxh64,   1, 1, NGX_LET_FUNC_PURE),
+	ngx_let_func(xxh3,    1, 1, NGX_LET_FUNC_PURE),
+	ngx_let_func(murmur3, 1, 1, NGX_LET_FUNC_PURE),
+	ngx_let_func(crc32c,  1, 1, NGX_LET_FUNC_PURE),
+
+	{ ngx_string("siphash"), 2, 2, NGX_LET_FUNC_PURE,
+		ngx_let_func_siphash, ngx_let_func_siphash_init },
+
+	/* string operations */
+	ngx_let_func(length, 1, 1, NGX_LET_FUNC_PURE),
+	ngx_let_func(substr, 3, 3, NGX_LET_FUNC_PURE),
+	ngx_let_func(ulength, 1, 1, NGX_LET_FUNC_PURE),
+	ngx_let_func(usubstr, 3, 3, NGX_LET_FUNC_PURE),
+
+	{ ngx_string("contains"), 2, 2, NGX_LET_FUNC_PURE,
+		ngx_let_func_contains, ngx_let_func_find_init },
+	{ ngx_string("index"), 2, 2, NGX_LET_FUNC_PURE,
+		ngx_let_func_index, ngx_let_func_find_init },
+	ngx_let_func(starts_with, 2, 2, NGX_LET_FUNC_PURE),
+	ngx_let_func(ends_with,   2, 2, NGX_LET_FUNC_PURE),
+	ngx_let_func(eq,          2, 2, NGX_LET_FUNC_PURE),
+
+	/* slices of argument */
+	{ ngx_string("field"), 3, 3, NGX_LET_FUNC_PURE,
+		ngx_let_func_field, ngx_let_func_find_init },
+	{ ngx_string("before"), 2, 2, NGX_LET_FUNC_PURE,
+		ngx_let_func_before, ngx_let_func_find_init },
+	{ ngx_string("after"), 2, 2, NGX_LET_FUNC_PURE,
+		ngx_let_func_after, ngx_let_func_find_init },
+	ngx_let_func(trim, 1, 1, NGX_LET_FUNC_PURE),
+	ngx_let_func(kv,   2, 4, NGX_LET_FUNC_PURE),
+
+	/* conversions; unchanged input is returned as is */
+	ngx_let_func(lower,     1, 1, NGX_LET_FUNC_PURE),
+	ngx_let_func(upper,     1, 1, NGX_LET_FUNC_PURE),
+	ngx_let_func(urlencode, 1, 1, NGX_LET_FUNC_PURE),
+	ngx_let_func(urldecode, 1, 1, NGX_LET_FUNC_PURE),
+	ngx_let_func(b64enc,    1, 1, NGX_LET_FUNC_PURE),
+	ngx_let_func(b64dec,    1, 1, NGX_LET_FUNC_PURE),
+
+	/* json( s path ); path is split when loading config if constant */
+	{ ngx_string("json"), 2, 2, NGX_LET_FUNC_PURE,
+		ngx_let_func_json, ngx_let_func_json_init },
+
+#if (NGX_PCRE)
+	/* regular expressions; pattern is constant */
+	{ ngx_string("match"), 2, 2, NGX_LET_FUNC_PURE,
+		ngx_let_func_match, ngx_let_func_regex_init },
+	{ ngx_string("extract"), 2, 3, NGX_LET_FUNC_PURE,
+		ngx_let_func_extract, ngx_let_func_extract_init },
+	{ ngx_string("replace"), 3, 3, NGX_LET_FUNC_PURE,
+		ngx_let_func_replace, ngx_let_func_replace_init },
+#endif
+
+	/* integer operations */
+	ngx_let_func(max, 2, 2, NGX_LET_FUNC_PURE),
+	ngx_let_func(min, 2, 2, NGX_LET_FUNC_PURE),
+
+	ngx_let_func(jumphash, 2, 2, NGX_LET_FUNC_PURE),
+	ngx_let_func(rendezvous, 2, NGX_LET_VARARGS, NGX_LET_FUNC_PURE),
+
+	{ ngx_string("split"), 2, NGX_LET_VARARGS, NGX_LET_FUNC_PURE, 
+		ngx_let_func_split, ngx_let_func_split_init },
+
+	/* let_zone counters; never folded or shared */
+	{ ngx_string("incr"), 1, 2, 0,
+		ngx_let_func_incr, ngx_let_func_counter_init },
+	{ ngx_string("get"), 1, 1, 0,
+		ngx_let_func_get, ngx_let_func_counter_init },
+
+	/* let_cache_zone statistics */
+	{ ngx_string("cache_hits"), 0, 0, 0,
+		ngx_let_func_cache_hits, ngx_let_func_cache_stats_init },
+	{ ngx_string("cache_misses"), 0, 0, 0,
+		ngx_let_func_cache_misses, ngx_let_func_cache_stats_init },
+
+	{ ngx_null_string, 0, 0, 0, NULL, NULL }
+};
+
+static ngx_let_func_t* ngx_let_find_func(ngx_str_t *name)
+{
+	ngx_let_func_t *f;
+
+	for(f = ngx_let_functions; f->name.len; ++f) {
+
+		if (f->name.len == name->len
+				&& !ngx_strncmp(f->name.data, name->data, name->len))
+			return f;
+	}
+
+	return NULL;
+}
+
+/* Processes 64-bit signed integers; result stays native */
+static ngx_int_t ngx_let_apply_binary_integer_op(ngx_let_ctx_t *ctx, int op, 
+		ngx_let_value_t* args, ngx_let_value_t* value)
+{
+	int64_t left, right;
+
+	if (ngx_let_value_int(ctx, &args[0]) != NGX_OK
+			|| ngx_let_value_int(ctx, &args[1]) != NGX_OK)
+		return NGX_ERROR;
+
+	left = args[0].num;
+	right = args[1].num;
+	
+	switch(op) {
+		
+		/* two's complement wraparound, signed overflow is undefined */
+		case '+':
+			left = (int64_t) ((uint64_t) left + (uint64_t) right);
+			break;
+			
+		case '-':
+			left = (int64_t) ((uint64_t) left - (uint64_t) right);
+			break;
+
+		case '*':
+			left = (int64_t) ((uint64_t) left * (uint64_t) right);
+			break;
+
+		case '/':
+		case '%':
+
+			if (right == 0 || (right == -1 && left == INT64_MIN)) {
+				ngx_log_error(NGX_LOG_ALERT, ctx->log, 0, 
+						"let invalid division %L %c %L", left, op, right);
+				return NGX_ERROR;
+			}
+
+			if (op == '/')
+				left /= right;
+			else
+				left %= right;
+
+			break;
+
+		case '&':
+			left &= right;
+			break;
+
+		case '|':
+			left |= right;
+			break;
+
+		default:
+			ngx_log_error(NGX_LOG_ALERT, ctx->log, 0, 
+					"let unexpected operation '%c'", op);
+			return NGX_ERROR;
+	}
+	
+	ngx_let_set_int(value, left);
+	
+	ngx_log_debug3(NGX_LOG_DEBUG_HTTP, ctx->log, 0, 
+			"let applying binary operation '%c' %L: %L", op, right, left);
+
+	return NGX_OK;
+}
+
+/* Empty string & zero are false */
+static ngx_uint_t ngx_let_value_true(ngx_let_value_t* v)
+{
+	if (!(v->flags & NGX_LET_VALUE_INT)) {
+
+		if (v->str.len == 0)
+			return 0;
+
+		if (ngx_let_toi(&v->str, &v->num) != NGX_OK)
+			return 1;
+
+		v->flags |= NGX_LET_VALUE_INT;
+	}
+
+	return v->num != 0;
+}
+
+/* Compares as integers if both values are numeric, as strings otherwise */
+static ngx_int_t ngx_let_compare(ngx_let_ctx_t *ctx, int op, 
+		ngx_let_value_t* args, ngx_let_value_t* value)
+{
+	ngx_int_t rc;
+	ngx_uint_t n;
+
+	for(n = 0; n < 2; ++n) {
+
+		if (!(args[n].flags & NGX_LET_VALUE_INT)
+				&& ngx_let_toi(&args[n].str, &args[n].num) == NGX_OK)
+		{
+			args[n].flags |= NGX_LET_VALUE_INT;
+		}
+	}
+
+	if (args[0].flags & args[1].flags & NGX_LET_VALUE_INT) {
+
+		rc = (args[0].num > args[1].num) - (args[0].num < args[1].num);
+
+	} else {
+
+		if (ngx_let_value_str(ctx, &args[0]) != NGX_OK
+				|| ngx_let_value_str(ctx, &args[1]) != NGX_OK)
+			return NGX_ERROR;
+
+		rc = ngx_memcmp(args[0].str.data, args[1].str.data,
+				ngx_min(args[0].str.len, args[1].str.len));
+
+		if (rc == 0)
+			rc = (args[0].str.len > args[1].str.len) 
+				- (args[0].str.len < args[1].str.len);
+	}
+
+	switch(op) {
+
+		case NGX_LOP_EQ:
+			rc = (rc == 0);
+			break;
+
+		case NGX_LOP_NE:
+			rc = (rc != 0);
+			break;
+
+		case '<':
+			rc = (rc < 0);
+			break;
+
+		default: /* '>' */
+			rc = (rc > 0);
+	}
+
+	ngx_let_set_int(value, rc);
+
+	return NGX_OK;
+}
+
+/* Compiled expression
+
+   Expression tree is lowered at config time into postfix instruction
+   array which is evaluated with fixed-size operand stack. */
+
+#define NGX_LET_OP_LITERAL   1
+#define NGX_LET_OP_VARIABLE  2
+#define NGX_LET_OP_CAPTURE   3
+#define NGX_LET_OP_BINARY    4
+#define NGX_LET_OP_CONCAT    5
+#define NGX_LET_OP_CALL      6
+#define NGX_LET_OP_SHARED    7
+#define NGX_LET_OP_COMPARE   8
+#define NGX_LET_OP_OPTIONAL  9   /* variable which may be not found */
+#define NGX_LET_OP_BOOL      10
+
+/* jumps are relative to next instruction */
+#define NGX_LET_OP_JUMP      11
+#define NGX_LET_OP_JUMP_FALSE 12  /* pops condition */
+#define NGX_LET_OP_AND       13  /* jumps with 0 if false, pops otherwise */
+#define NGX_LET_OP_OR        14  /* jumps with 1 if true, pops otherwise */
+#define NGX_LET_OP_COALESCE  15  /* jumps if not empty, pops otherwise */
+
+#define NGX_LET_OP_CACHED    16  /* call through let_cache_zone */
+#define NGX_LET_OP_MEMO      17  /* call through worker memo table */
+
+#define ngx_let_is_jump(code) \
+	((code) >= NGX_LET_OP_JUMP && (code) <= NGX_LET_OP_COALESCE)
+
+#define NGX_LET_STACK_SIZE   64
+
+typedef struct {
+
+	ngx_uint_t code;
+
+	ngx_uint_t arg;       /* variable / capture index, operation, argc,
+	                         shared slot, jump offset */
+
+	ngx_let_func_t *func; /* bound function */
+
+	void *data;           /* call site data; depends on constant 
+	                         arguments only */
+
+	ngx_let_value_t value; /* literal value, pre-parsed */
+
+} ngx_let_insn_t;
+
+typedef struct ngx_http_let_loc_conf_s ngx_http_let_loc_conf_t;
+
+typedef struct {
+
+	ngx_let_insn_t *code;
+
+	ngx_uint_t ncode;
+
+	ngx_http_let_loc_conf_t *conf; /* location sharing subexpressions */
+
+	ngx_array_t *exprs;   /* shareable subexpressions, config time only */
+
+	ngx_uint_t nocacheable; /* calls impure function */
+
+} ngx_let_prog_t;
+
+/* code range of compiled subexpression */
+typedef struct {
+
+	ngx_uint_t start;
+
+	ngx_uint_t end;
+
+} ngx_let_range_t;
+
+struct ngx_http_let_loc_conf_s {
+
+	ngx_array_t *lets;    /* ngx_let_prog_t* */
+
+	ngx_array_t *shared;  /* ngx_let_prog_t*, indexed by slot */
+};
+
+/* Per-request values of shared subexpressions; they are valid while
+   regex captures stay the same */
+typedef struct {
+
+	ngx_http_let_loc_conf_t *conf;
+
+	ngx_let_value_t *slots;
+
+#if (NGX_PCRE)
+	u_char *captures_data;
+
+	int *captures;
+
+	ngx_uint_t ncaptures;
+#endif
+
+} ngx_http_let_ctx_t;
+
+static ngx_int_t ngx_let_run_shared(ngx_let_ctx_t* ctx,
+		ngx_http_let_loc_conf_t* lcf, ngx_uint_t slot, ngx_let_value_t* value);
+
+static ngx_int_t ngx_let_run(ngx_let_ctx_t* ctx, ngx_let_prog_t* prog,
+		ngx_let_value_t* value)
+{
+	ngx_let_value_t stack[NGX_LET_STACK_SIZE];
+	ngx_http_variable_value_t* vv;
+	ngx_let_insn_t *pc, *last;
+	ngx_http_request_t* r;
+	ngx_let_value_t *sp, *a;
+	ngx_int_t ret;
+	int *cap;
+	ngx_int_t ncap;
+	size_t len;
+	u_char *s, *p;
+
+	r = ctx->request;
+	sp = stack;
+
+	for(pc = prog->code, last = pc + prog->ncode; pc != last; ++pc) {
+
+		switch(pc->code) {
+
+			case NGX_LET_OP_OPTIONAL:
+
+				vv = ngx_http_get_indexed_variable(r, pc->arg);
+
+				if (vv == NULL)
+					return NGX_ERROR;
+
+				sp->flags = NGX_LET_VALUE_STR;
+				sp->str.data = vv->data;
+				sp->str.len = vv->not_found ? 0 : vv->len;
+
+				ctx->nocache |= vv->no_cacheable;
+
+				++sp;
+
+				break;
+
+			case NGX_LET_OP_VARIABLE:
+
+				vv = ngx_http_get_indexed_variable(r, pc->arg);
+
+				if (vv == NULL || vv->not_found) {
+					ngx_log_error(NGX_LOG_ALERT, ctx->log, 0, 
+							"let variable %d not found", pc->arg);
+
+					return NGX_ERROR;
+				}
+
+				sp->flags = NGX_LET_VALUE_STR;
+				sp->str.data = vv->data;
+				sp->str.len = vv->len;
+
+				ctx->nocache |= vv->no_cacheable;
+
+				ngx_log_debug3(NGX_LOG_DEBUG_HTTP, ctx->log, 0, 
+							"let getting variable %d: '%*s'", pc->arg,
+							sp->str.len, sp->str.data);
+
+				++sp;
+
+				break;
+
+			case NGX_LET_OP_CAPTURE:
+
+				if (pc->arg >= r->ncaptures)
+					return NGX_ERROR;
+
+				cap = r->captures;
+
+				ncap = pc->arg * 2;
+
+				sp->flags = NGX_LET_VALUE_STR;
+				sp->str.data = r->captures_data + cap[ncap];
+				sp->str.len = cap[ncap + 1] - cap[ncap];
+
+				ngx_log_debug3(NGX_LOG_DEBUG_HTTP, ctx->log, 0, 
+							"let getting capture %d: '%*s'", pc->arg,
+							sp->str.len, sp->str.data);
+
+				++sp;
+
+				break;
+
+			case NGX_LET_OP_LITERAL:
+
+				*sp = pc->value;
+
+				ngx_log_debug2(NGX_LOG_DEBUG_HTTP, ctx->log, 0, 
+							"let getting literal: '%*s'", sp->str.len, sp->str.data);
+
+				++sp;
+
+				break;
+
+			case NGX_LET_OP_CALL:
+
+				ngx_log_debug2(NGX_LOG_DEBUG_HTTP, ctx->log, 0, 
+							"let calling function '%V'; argc: %d", 
+							&pc->func->name, pc->arg);
+
+				sp -= pc->arg;
+
+				ret = pc->func->handler(ctx, sp, pc->arg, pc->data, sp);
+				if (ret != NGX_OK)
+					return ret;
+
+				++sp;
+
+				break;
+
+			case NGX_LET_OP_CACHED:
+
+				sp -= pc->arg;
+
+				ret = ngx_let_cached(ctx, pc->func, sp, pc->arg, pc->data, sp);
+				if (ret != NGX_OK)
+					return ret;
+
+				++sp;
+
+				break;
+
+			case NGX_LET_OP_MEMO:
+
+				sp -= pc->arg;
+
+				ret = ngx_let_memo_call(ctx, pc->func, sp, pc->arg, pc->data, sp);
+				if (ret != NGX_OK)
+					return ret;
+
+				++sp;
+
+				break;
+
+			case NGX_LET_OP_SHARED:
+
+				ret = ngx_let_run_shared(ctx, prog->conf, pc->arg, sp);
+				if (ret != NGX_OK)
+					return ret;
+
+				++sp;
+
+				break;
+
+			case NGX_LET_OP_COMPARE:
+
+				sp -= 2;
+
+				ret = ngx_let_compare(ctx, pc->arg, sp, sp);
+				if (ret != NGX_OK)
+					return ret;
+
+				++sp;
+
+				break;
+
+			case NGX_LET_OP_BOOL:
+
+				ngx_let_set_int(&sp[-1], ngx_let_value_true(&sp[-1]));
+
+				break;
+
+			case NGX_LET_OP_JUMP:
+
+				pc += pc->arg;
+
+				break;
+
+			case NGX_LET_OP_JUMP_FALSE:
+
+				if (!ngx_let_value_true(--sp))
+					pc += pc->arg;
+
+				break;
+
+			case NGX_LET_OP_AND:
+			case NGX_LET_OP_OR:
+
+				/* untaken operand is skipped */
+				if (ngx_let_value_true(&sp[-1]) == (pc->code == NGX_LET_OP_OR)) {
+
+					ngx_let_set_int(&sp[-1], pc->code == NGX_LET_OP_OR);
+					pc += pc->arg;
+
+				} else {
+
+					--sp;
+				}
+
+				break;
+
+			case NGX_LET_OP_COALESCE:
+
+				if ((sp[-1].flags & NGX_LET_VALUE_INT) || sp[-1].str.len)
+					pc += pc->arg;
+				else
+					--sp;
+
+				break;
+
+			case NGX_LET_OP_BINARY:
+
+				/* binary integer operation */
+
+				sp -= 2;
+
+				ret = ngx_let_apply_binary_integer_op(ctx, pc->arg, sp, sp);
+				if (ret != NGX_OK)
+					return ret;
+
+				++sp;
+
+				break;
+
+			case NGX_LET_OP_CONCAT:
+
+				/* n-ary string concatenation into single buffer;
+				   integers are formatted in place */
+
+				sp -= pc->arg;
+
+				for(a = sp, len = 0; a != sp + pc->arg; ++a)
+					len += (a->flags & NGX_LET_VALUE_STR) ? a->str.len : NGX_INT64_LEN;
+
+				s = ngx_pnalloc(ctx->pool, len);
+				if (s == NULL)
+					return NGX_ERROR;
+
+				for(a = sp, p = s; a != sp + pc->arg; ++a) {
+
+					p = (a->flags & NGX_LET_VALUE_STR)
+						? ngx_cpymem(p, a->str.data, a->str.len)
+						: ngx_let_itoa(p, a->num);
+				}
+
+				sp->flags = NGX_LET_VALUE_STR;
+				sp->str.data = s;
+				sp->str.len = p - s;
+
+				ngx_log_debug3(NGX_LOG_DEBUG_HTTP, ctx->log, 0, 
+						"let %d strings concatenated '%*s'", pc->arg,
+						sp->str.len, sp->str.data);
+
+				++sp;
+
+				break;
+		}
+	}
+
+	*value = stack[0];
+
+	return NGX_OK;
+}
+
+/* Evaluates shared subexpression at most once per request */
+static ngx_int_t ngx_let_run_shared(ngx_let_ctx_t* ctx,
+		ngx_http_let_loc_conf_t* lcf, ngx_uint_t slot, ngx_let_value_t* value)
+{
+	ngx_http_let_ctx_t* lctx;
+	ngx_http_request_t* r;
+	ngx_let_prog_t** shared;
+	ngx_uint_t nocache;
+	ngx_int_t ret;
+
+	r = ctx->request;
+
+	lctx = ngx_http_get_module_ctx(r, ngx_http_let_module);
+
+	if (lctx == NULL || lctx->conf != lcf) {
+
+		if (lctx == NULL) {
+
+			lctx = ngx_pcalloc(r->pool, sizeof(ngx_http_let_ctx_t));
+			if (lctx == NULL)
+				return NGX_ERROR;
+
+			ngx_http_set_ctx(r, lctx, ngx_http_let_module);
+		}
+
+		lctx->conf = lcf;
+		lctx->slots = ngx_pcalloc(r->pool, 
+				lcf->shared->nelts * sizeof(ngx_let_value_t));
+
+		if (lctx->slots == NULL)
+			return NGX_ERROR;
+	}
+
+#if (NGX_PCRE)
+	/* regex matched since slots were filled */
+	if (r->ncaptures != lctx->ncaptures 
+			|| r->captures_data != lctx->captures_data
+			|| (r->ncaptures && ngx_memcmp(r->captures, lctx->captures,
+					r->ncaptures * sizeof(int))))
+	{
+		ngx_memzero(lctx->slots, 
+				lcf->shared->nelts * sizeof(ngx_let_value_t));
+
+		if (r->ncaptures > lctx->ncaptures) {
+
+			lctx->captures = ngx_palloc(r->pool, r->ncaptures * sizeof(int));
+			if (lctx->captures == NULL)
+				return NGX_ERROR;
+		}
+
+		if (r->ncaptures)
+			ngx_memcpy(lctx->captures, r->captures, 
+					r->ncaptures * sizeof(int));
+
+		lctx->ncaptures = r->ncaptures;
+		lctx->captures_data = r->captures_data;
+	}
+#endif
+
+	/* computed values always have some form set */
+	if (lctx->slots[slot].flags) {
+
+		*value = lctx->slots[slot];
+
+		ngx_log_debug1(NGX_LOG_DEBUG_HTTP, ctx->log, 0, 
+				"let shared expression %d reused", slot);
+
+		return NGX_OK;
+	}
+
+	shared = lcf->shared->elts;
+
+	nocache = ctx->nocache;
+	ctx->nocache = 0;
+
+	ret = ngx_let_run(ctx, shared[slot], value);
+	if (ret != NGX_OK)
+		return ret;
+
+	/* values of non-cacheable variables may change */
+	if (!ctx->nocache)
+		lctx->slots[slot] = *value;
+
+	ctx->nocache |= nocache;
+
+	return NGX_OK;
+}
+
+/* Expression compiler state */
+typedef struct {
+
+	ngx_array_t code;     /* ngx_let_insn_t */
+
+	ngx_array_t exprs;    /* ngx_let_range_t */
+
+	ngx_uint_t label;     /* last jump target or argument boundary;
+	                         literals are not joined across it */
+
+} ngx_let_compile_t;
+
+/* Sets numeric form of constant string if it has one */
+static void ngx_let_parse_literal(ngx_let_value_t* v)
+{
+	v->flags |= NGX_LET_VALUE_STR;
+
+	if (!(v->flags & NGX_LET_VALUE_INT)
+			&& ngx_let_toi(&v->str, &v->num) == NGX_OK)
+	{
+		v->flags |= NGX_LET_VALUE_INT;
+	}
+}
+
+/* Finishes compound expression emitted from start; replaces it with its
+   value if it is constant or records it as candidate for sharing */
+static char* ngx_let_complete(ngx_conf_t* cf, ngx_let_compile_t* lc,
+		ngx_uint_t start)
+{
+	ngx_array_t* code;
+	ngx_let_insn_t* insn;
+	ngx_let_prog_t prog;
+	ngx_let_ctx_t ctx;
+	ngx_let_value_t value;
+	ngx_let_range_t* range;
+	ngx_uint_t n;
+
+	code = &lc->code;
+	insn = code->elts;
+
+	/* arguments are already folded */
+	for(n = start; n < code->nelts - 1; ++n) {
+
+		if (insn[n].code != NGX_LET_OP_LITERAL)
+			break;
+	}
+
+	if (n != code->nelts - 1) {
+
+		/* results of impure calls are never shared */
+		for(n = start; n < code->nelts; ++n) {
+
+			if (insn[n].code == NGX_LET_OP_CALL
+					&& !(insn[n].func->flags & NGX_LET_FUNC_PURE))
+				return NGX_CONF_OK;
+		}
+
+		if (insn[n - 1].code != NGX_LET_OP_CALL
+				&& insn[n - 1].code != NGX_LET_OP_CONCAT)
+			return NGX_CONF_OK;
+
+		range = ngx_array_push(&lc->exprs);
+		if (range == NULL)
+			return NGX_CONF_ERROR;
+
+		range->start = start;
+		range->end = code->nelts;
+
+		return NGX_CONF_OK;
+	}
+
+	prog.code = insn + start;
+	prog.ncode = code->nelts - start;
+
+	ctx.request = NULL;
+	ctx.pool = cf->pool;
+	ctx.log = cf->log;
+	ctx.nocache = 0;
+
+	/* keep both forms so nothing is converted per request */
+	if (ngx_let_run(&ctx, &prog, &value) != NGX_OK
+			|| ngx_let_value_str(&ctx, &value) != NGX_OK)
+	{
+		return "has invalid constant expression";
+	}
+
+	ngx_let_parse_literal(&value);
+
+	code->nelts = start + 1;
+
+	/* subexpressions are gone */
+	range = lc->exprs.elts;
+
+	while (lc->exprs.nelts && range[lc->exprs.nelts - 1].start >= start)
+		lc->exprs.nelts--;
+
+	ngx_memzero(&insn[start], sizeof(ngx_let_insn_t));
+	insn[start].code = NGX_LET_OP_LITERAL;
+	insn[start].value = value;
+
+	return NGX_CONF_OK;
+}
+
+static char* ngx_let_compile_node(ngx_conf_t* cf, ngx_let_compile_t* lc,
+		ngx_let_node_t* node, ngx_uint_t sp);
+
+/* Emits operands of concatenation chain; adjacent literals are joined.
+   n is number of operands emitted so far */
+static char* ngx_let_compile_concat(ngx_conf_t* cf, ngx_let_compile_t* lc,
+		ngx_let_node_t* node, ngx_uint_t sp, ngx_uint_t* n)
+{
+	ngx_array_t* code;
+	ngx_let_node_t** anode;
+	ngx_let_insn_t* insn;
+	ngx_let_value_t* prev;
+	ngx_uint_t start;
+	u_char* s;
+	char* rv;
+
+	code = &lc->code;
+
+	if (node != NULL 
+			&& node->type == NGX_LTYPE_OPERATION
+			&& node->index == '.')
+	{
+		anode = node->args.elts;
+
+		rv = ngx_let_compile_concat(cf, lc, anode[0], sp, n);
+		if (rv != NGX_CONF_OK)
+			return rv;
+
+		return ngx_let_compile_concat(cf, lc, anode[1], sp, n);
+	}
+
+	start = code->nelts;
+
+	rv = ngx_let_compile_node(cf, lc, node, sp + *n);
+	if (rv != NGX_CONF_OK)
+		return rv;
+
+	insn = code->elts;
+
+	/* single literal instruction is whole operand; previous literal
+	   may end conditional branch if start is jump target */
+	if (*n && code->nelts == start + 1
+			&& insn[start].code == NGX_LET_OP_LITERAL
+			&& insn[start - 1].code == NGX_LET_OP_LITERAL
+			&& lc->label != start)
+	{
+		prev = &insn[start - 1].value;
+
+		s = ngx_pnalloc(cf->pool, prev->str.len + insn[start].value.str.len);
+		if (s == NULL)
+			return NGX_CONF_ERROR;
+
+		ngx_memcpy(s, prev->str.data, prev->str.len);
+		ngx_memcpy(s + prev->str.len, insn[start].value.str.data,
+				insn[start].value.str.len);
+
+		prev->flags = NGX_LET_VALUE_STR;
+		prev->str.data = s;
+		prev->str.len += insn[start].value.str.len;
+
+		ngx_let_parse_literal(prev);
+
+		code->nelts--;
+
+		return NGX_CONF_OK;
+	}
+
+	++*n;
+
+	return NGX_CONF_OK;
+}
+
+/* Conditional evaluation
+
+   Untaken branches are skipped with relative jumps. Conditions known at
+   compile time select their branch right here so no jump is emitted. */
+
+/* Emits jump with offset patched later by ngx_let_patch_jump */
+static ngx_int_t ngx_let_emit_jump(ngx_let_compile_t* lc, ngx_uint_t code,
+		ngx_uint_t* pos)
+{
+	ngx_let_insn_t* insn;
+
+	*pos = lc->code.nelts;
+
+	insn = ngx_array_push(&lc->code);
+	if (insn == NULL)
+		return NGX_ERROR;
+
+	ngx_memzero(insn, sizeof(ngx_let_insn_t));
+	insn->code = code;
+
+	return NGX_OK;
+}
+
+/* Makes jump at pos target next instruction */
+static void ngx_let_patch_jump(ngx_let_compile_t* lc, ngx_uint_t pos)
+{
+	ngx_let_insn_t* insn;
+
+	insn = lc->code.elts;
+	insn[pos].arg = lc->code.nelts - pos - 1;
+
+	lc->label = lc->code.nelts;
+}
+
+/* Returns constant emitted from start if any */
+static ngx_let_value_t* ngx_let_constant(ngx_let_compile_t* lc,
+		ngx_uint_t start)
+{
+	ngx_let_insn_t* insn;
+
+	insn = lc->code.elts;
+
+	if (lc->code.nelts != start + 1 || insn[start].code != NGX_LET_OP_LITERAL)
+		return NULL;
+
+	return &insn[start].value;
+}
+
+/* Emits operand which is empty if it is variable not found */
+static char* ngx_let_compile_optional(ngx_conf_t* cf, ngx_let_compile_t* lc,
+		ngx_let_node_t* node, ngx_uint_t sp)
+{
+	ngx_let_insn_t* insn;
+	char* rv;
+
+	rv = ngx_let_compile_node(cf, lc, node, sp);
+	if (rv != NGX_CONF_OK)
+		return rv;
+
+	insn = lc->code.elts;
+	insn = &insn[lc->code.nelts - 1];
+
+	if (node->type == NGX_LTYPE_VARIABLE)
+		insn->code = NGX_LET_OP_OPTIONAL;
+
+	return NGX_CONF_OK;
+}
+
+/* a && b, a || b; result is 0 or 1 */
+static char* ngx_let_compile_logical(ngx_conf_t* cf, ngx_let_compile_t* lc,
+		ngx_let_node_t* node, ngx_uint_t sp)
+{
+	ngx_let_node_t** anode;
+	ngx_let_value_t* v;
+	ngx_let_insn_t* insn;
+	ngx_uint_t start, jump, or;
+	char* rv;
+
+	anode = node->args.elts;
+	or = (node->index == NGX_LOP_OR);
+	start = lc->code.nelts;
+
+	/* set only if jump is emitted */
+	jump = 0;
+
+	rv = ngx_let_compile_optional(cf, lc, anode[0], sp);
+	if (rv != NGX_CONF_OK)
+		return rv;
+
+	v = ngx_let_constant(lc, start);
+
+	if (v) {
+
+		if (ngx_let_value_true(v) == or) {
+
+			/* right operand is never evaluated */
+			v->flags = NGX_LET_VALUE_STR|NGX_LET_VALUE_INT;
+			v->num = or;
+			v->str.data = (u_char*)(or ? "1" : "0");
+			v->str.len = 1;
+
+			return NGX_CONF_OK;
+		}
+
+		lc->code.nelts = start;
+
+	} else {
+
+		if (ngx_let_emit_jump(lc, or ? NGX_LET_OP_OR : NGX_LET_OP_AND, 
+					&jump) != NGX_OK)
+			return NGX_CONF_ERROR;
+	}
+
+	rv = ngx_let_compile_optional(cf, lc, anode[1], sp);
+	if (rv != NGX_CONF_OK)
+		return rv;
+
+	insn = ngx_array_push(&lc->code);
+	if (insn == NULL)
+		return NGX_CONF_ERROR;
+
+	ngx_memzero(insn, sizeof(ngx_let_insn_t));
+	insn->code = NGX_LET_OP_BOOL;
+
+	if (v)
+		return ngx_let_complete(cf, lc, start);
+
+	ngx_let_patch_jump(lc, jump);
+
+	return NGX_CONF_OK;
+}
+
+/* if( cond then [else] ); else is empty string by default */
+static char* ngx_let_compile_if(ngx_conf_t* cf, ngx_let_compile_t* lc,
+		ngx_let_node_t* node, ngx_uint_t sp)
+{
+	ngx_let_node_t** anode;
+	ngx_let_value_t* v;
+	ngx_let_insn_t* insn;
+	ngx_uint_t start, jfalse, jend;
+	char* rv;
+
+	anode = node->args.elts;
+	start = lc->code.nelts;
+
+	rv = ngx_let_compile_optional(cf, lc, anode[0], sp);
+	if (rv != NGX_CONF_OK)
+		return rv;
+
+	v = ngx_let_constant(lc, start);
+
+	if (v) {
+
+		lc->code.nelts = start;
+
+		if (ngx_let_value_true(v))
+			return ngx_let_compile_node(cf, lc, anode[1], sp);
+
+		if (node->args.nelts == 3)
+			return ngx_let_compile_node(cf, lc, anode[2], sp);
+
+	} else {
+
+		if (ngx_let_emit_jump(lc, NGX_LET_OP_JUMP_FALSE, &jfalse) != NGX_OK)
+			return NGX_CONF_ERROR;
+
+		rv = ngx_let_compile_node(cf, lc, anode[1], sp);
+		if (rv != NGX_CONF_OK)
+			return rv;
+
+		if (ngx_let_emit_jump(lc, NGX_LET_OP_JUMP, &jend) != NGX_OK)
+			return NGX_CONF_ERROR;
+
+		ngx_let_patch_jump(lc, jfalse);
+
+		if (node->args.nelts == 3) {
+
+			rv = ngx_let_compile_node(cf, lc, anode[2], sp);
+			if (rv != NGX_CONF_OK)
+				return rv;
+
+			ngx_let_patch_jump(lc, jend);
+
+			return NGX_CONF_OK;
+		}
+	}
+
+	insn = ngx_array_push(&lc->code);
+	if (insn == NULL)
+		return NGX_CONF_ERROR;
+
+	ngx_memzero(insn, sizeof(ngx_let_insn_t));
+	insn->code = NGX_LET_OP_LITERAL;
+	insn->value.flags = NGX_LET_VALUE_STR;
+	insn->value.str.data = (u_char*)"";
+
+	if (!v)
+		ngx_let_patch_jump(lc, jend);
+
+	return NGX_CONF_OK;
+}
+
+/* coalesce( a b ... ); first non-empty argument */
+static char* ngx_let_compile_coalesce(ngx_conf_t* cf, ngx_let_compile_t* lc,
+		ngx_let_node_t* node, ngx_uint_t sp)
+{
+	ngx_let_node_t** anode;
+	ngx_let_value_t* v;
+	ngx_uint_t *jumps, njumps, n, start;
+	char* rv;
+
+	anode = node->args.elts;
+
+	jumps = ngx_palloc(cf->temp_pool, node->args.nelts * sizeof(ngx_uint_t));
+	if (jumps == NULL)
+		return NGX_CONF_ERROR;
+
+	njumps = 0;
+
+	for(n = 0; n < node->args.nelts; ++n) {
+
+		start = lc->code.nelts;
+
+		rv = ngx_let_compile_optional(cf, lc, anode[n], sp);
+		if (rv != NGX_CONF_OK)
+			return rv;
+
+		if (n == node->args.nelts - 1)
+			break;
+
+		v = ngx_let_constant(lc, start);
+
+		if (v == NULL) {
+
+			if (ngx_let_emit_jump(lc, NGX_LET_OP_COALESCE, &jumps[njumps++])
+					!= NGX_OK)
+				return NGX_CONF_ERROR;
+
+			continue;
+		}
+
+		/* arguments after non-empty constant are never evaluated */
+		if (v->str.len)
+			break;
+
+		lc->code.nelts = start;
+	}
+
+	while (njumps)
+		ngx_let_patch_jump(lc, jumps[--njumps]);
+
+	return NGX_CONF_OK;
+}
+
+/* cache( call ttl ); call result is kept in let_cache_zone */
+static char* ngx_let_compile_cache(ngx_conf_t* cf, ngx_let_compile_t* lc,
+		ngx_let_node_t* node, ngx_uint_t sp)
+{
+	ngx_let_node_t** anode;
+	ngx_let_cache_site_t* site;
+	ngx_let_insn_t* insn;
+	ngx_uint_t start;
+	ngx_int_t ttl;
+	char* rv;
+
+	anode = node->args.elts;
+	start = lc->code.nelts;
+
+	if (anode[0] == NULL || anode[0]->type != NGX_LTYPE_FUNCTION)
+		return "needs function call to cache";
+
+	if (anode[1] == NULL || anode[1]->type != NGX_LTYPE_LITERAL)
+		return "needs constant cache time";
+
+	ttl = ngx_parse_time(&anode[1]->name, 0);
+	if (ttl == NGX_ERROR)
+		return "has invalid cache time";
+
+	rv = ngx_let_compile_node(cf, lc, anode[0], sp);
+	if (rv != NGX_CONF_OK)
+		return rv;
+
+	/* constant result is never looked up */
+	if (ngx_let_constant(lc, start))
+		return NGX_CONF_OK;
+
+	insn = lc->code.elts;
+	insn = &insn[lc->code.nelts - 1];
+
+	if (insn->code != NGX_LET_OP_CALL)
+		return "needs function call to cache";
+
+	if (!(insn->func->flags & NGX_LET_FUNC_PURE))
+		return "can cache pure functions only";
+
+	site = ngx_palloc(cf->pool, sizeof(ngx_let_cache_site_t));
+	if (site == NULL)
+		return NGX_CONF_ERROR;
+
+	/* zone may be declared later; checked with main conf */
+	site->lmcf = ngx_http_conf_get_module_main_conf(cf, ngx_http_let_module);
+	site->lmcf->cached = 1;
+	site->ttl = ttl;
+	site->data = insn->data;
+
+	insn->code = NGX_LET_OP_CACHED;
+	insn->data = site;
+
+	return NGX_CONF_OK;
+}
+
+typedef char* (*ngx_let_special_pt)(ngx_conf_t* cf, ngx_let_compile_t* lc,
+		ngx_let_node_t* node, ngx_uint_t sp);
+
+/* Functions compiled into jumps */
+typedef struct {
+
+	ngx_str_t name;
+
+	ngx_uint_t min_args;
+
+	ngx_uint_t max_args;
+
+	ngx_let_special_pt compile;
+
+} ngx_let_special_t;
+
+static ngx_let_special_t ngx_let_specials[] = {
+
+	{ ngx_string("if"), 2, 3, ngx_let_compile_if },
+	{ ngx_string("coalesce"), 1, NGX_LET_VARARGS, ngx_let_compile_coalesce },
+	{ ngx_string("cache"), 2, 2, ngx_let_compile_cache },
+
+	{ ngx_null_string, 0, 0, NULL }
+};
+
+/* Emits postfix code for node; sp is operand stack depth before node */
+static char* ngx_let_compile_node(ngx_conf_t* cf, ngx_let_compile_t* lc,
+		ngx_let_node_t* node, ngx_uint_t sp)
+{
+	ngx_let_special_t* special;
+	ngx_let_func_t* func;
+	ngx_let_value_t *consts, *v;
+	ngx_uint_t argc, argstart;
+
+	ngx_array_t* code;
+	ngx_let_node_t** anode;
+	ngx_let_insn_t* insn;
+	ngx_uint_t n, start;
+	char* rv;
+
+	code = &lc->code;
+
+	if (node == NULL)
+		return "has invalid expression";
+
+	if (sp >= NGX_LET_STACK_SIZE)
+		return "has too complex expression";
+
+	start = code->nelts;
+
+	if (node->type == NGX_LTYPE_OPERATION && node->index == '.') {
+
+		n = 0;
+
+		rv = ngx_let_compile_concat(cf, lc, node, sp, &n);
+		if (rv != NGX_CONF_OK)
+			return rv;
+
+		/* everything joined into one literal */
+		if (n == 1)
+			return NGX_CONF_OK;
+
+		insn = ngx_array_push(code);
+		if (insn == NULL)
+			return NGX_CONF_ERROR;
+
+		ngx_memzero(insn, sizeof(ngx_let_insn_t));
+		insn->code = NGX_LET_OP_CONCAT;
+		insn->arg = n;
+
+		return ngx_let_complete(cf, lc, start);
+	}
+
+	if (node->type == NGX_LTYPE_OPERATION 
+			&& (node->index == NGX_LOP_AND || node->index == NGX_LOP_OR))
+	{
+		return ngx_let_compile_logical(cf, lc, node, sp);
+	}
+
+	/* branches are evaluated lazily */
+	if (node->type == NGX_LTYPE_FUNCTION) {
+
+		for(special = ngx_let_specials; special->compile; ++special) {
+
+			if (special->name.len != node->name.len
+					|| ngx_strncmp(special->name.data, node->name.data, 
+						node->name.len))
+			{
+				continue;
+			}
+
+			if (node->args.nelts < special->min_args
+					|| node->args.nelts > special->max_args)
+			{
+				ngx_conf_log_error(NGX_LOG_EMERG, cf, 0, 
+						"let function \"%V\" does not accept %ui arguments",
+						&node->name, node->args.nelts);
+				return NGX_CONF_ERROR;
+			}
+
+			return special->compile(cf, lc, node, sp);
+		}
+	}
+
+	func = NULL;
+
+	if (node->type == NGX_LTYPE_FUNCTION) {
+
+		func = ngx_let_find_func(&node->name);
+
+		if (func == NULL) {
+			ngx_conf_log_error(NGX_LOG_EMERG, cf, 0, 
+					"let undefined function \"%V\"", &node->name);
+			return NGX_CONF_ERROR;
+		}
+
+		if (node->args.nelts < func->min_args
+				|| node->args.nelts > func->max_args)
+		{
+			ngx_conf_log_error(NGX_LOG_EMERG, cf, 0, 
+					"let function \"%V\" does not accept %ui arguments",
+					&node->name, node->args.nelts);
+			return NGX_CONF_ERROR;
+		}
+	}
+
+	/* arguments go first */
+	argc = 0;
+	consts = NULL;
+
+	if (func && func->init) {
+
+		consts = ngx_pcalloc(cf->temp_pool, 
+				NGX_LET_STACK_SIZE * sizeof(ngx_let_value_t));
+		if (consts == NULL)
+			return NGX_CONF_ERROR;
+	}
+
+	if (node->type == NGX_LTYPE_FUNCTION 
+			|| node->type == NGX_LTYPE_OPERATION) 
+	{
+		anode = node->args.elts;
+
+		for(n = 0; n < node->args.nelts; ++n) {
+
+			/* operands of concatenation are passed as arguments */
+			if (func && (func->flags & NGX_LET_FUNC_CONCAT)
+					&& (n || !(func->flags & NGX_LET_FUNC_KEY)))
+			{
+				rv = ngx_let_compile_concat(cf, lc, anode[n], sp, &argc);
+				if (rv != NGX_CONF_OK)
+					return rv;
+
+				continue;
+			}
+
+			argstart = code->nelts;
+
+			rv = ngx_let_compile_node(cf, lc, anode[n], sp + argc);
+			if (rv != NGX_CONF_OK)
+				return rv;
+
+			v = ngx_let_constant(lc, argstart);
+
+			if (consts && v)
+				consts[argc] = *v;
+
+			/* key is never joined with message */
+			lc->label = code->nelts;
+
+			++argc;
+		}
+	}
+
+	insn = ngx_array_push(code);
+	if (insn == NULL)
+		return NGX_CONF_ERROR;
+
+	ngx_memzero(insn, sizeof(ngx_let_insn_t));
+
+	switch(node->type) {
+
+		case NGX_LTYPE_VARIABLE:
+
+			if (node->index == NGX_ERROR)
+				return NGX_CONF_ERROR;
+
+			insn->code = NGX_LET_OP_VARIABLE;
+			insn->arg = node->index;
+			break;
+
+		case NGX_LTYPE_CAPTURE:
+
+			insn->code = NGX_LET_OP_CAPTURE;
+			insn->arg = node->index;
+			break;
+
+		case NGX_LTYPE_LITERAL:
+
+			/* numeric literals are parsed once here */
+			insn->code = NGX_LET_OP_LITERAL;
+			insn->value.str = node->name;
+
+			ngx_let_parse_literal(&insn->value);
+
+			break;
+
+		case NGX_LTYPE_FUNCTION:
+
+			insn->code = NGX_LET_OP_CALL;
+			insn->arg = argc;
+			insn->func = func;
+
+			if (func->init) {
+
+				rv = func->init(cf, consts, argc, &insn->data);
+				if (rv != NGX_CONF_OK)
+					return rv;
+			}
+
+			if (insn->func->flags & NGX_LET_FUNC_PURE)
+				return ngx_let_complete(cf, lc, start);
+
+			break;
+
+		case NGX_LTYPE_OPERATION:
+
+			insn->code = (node->index == NGX_LOP_EQ || node->index == NGX_LOP_NE
+					|| node->index == '<' || node->index == '>')
+				? NGX_LET_OP_COMPARE : NGX_LET_OP_BINARY;
+			insn->arg = node->index;
+
+			return ngx_let_complete(cf, lc, start);
+
+		default:
+			return "has invalid expression";
+	}
+
+	return NGX_CONF_OK;
+}
+
+static char* ngx_let_jump_names[] = {
+	"jump", "jump if false", "and", "or", "jump if not empty"
+};
+
+/* Logs compiled program; shows folded constants under nginx -t */
+static void ngx_let_dump(ngx_conf_t* cf, ngx_let_prog_t* prog)
+{
+	ngx_let_insn_t *pc, *last;
+
+	for(pc = prog->code, last = pc + prog->ncode; pc != last; ++pc) {
+
+		switch(pc->code) {
+
+			case NGX_LET_OP_LITERAL:
+
+				if (pc->value.flags & NGX_LET_VALUE_INT) {
+					ngx_log_debug(NGX_LOG_INFO, cf->log, 0, 
+							"let code: literal '%V' (%L)", &pc->value.str, pc->value.num);
+				} else {
+					ngx_log_debug(NGX_LOG_INFO, cf->log, 0, 
+							"let code: literal '%V'", &pc->value.str);
+				}
+				break;
+
+			case NGX_LET_OP_VARIABLE:
+				ngx_log_debug(NGX_LOG_INFO, cf->log, 0, 
+						"let code: variable %ui", pc->arg);
+				break;
+
+			case NGX_LET_OP_CAPTURE:
+				ngx_log_debug(NGX_LOG_INFO, cf->log, 0, 
+						"let code: capture %ui", pc->arg);
+				break;
+
+			case NGX_LET_OP_CALL:
+				ngx_log_debug(NGX_LOG_INFO, cf->log, 0, 
+						"let code: call '%V' %ui", &pc->func->name, pc->arg);
+				break;
+
+			case NGX_LET_OP_CACHED:
+				ngx_log_debug(NGX_LOG_INFO, cf->log, 0, 
+						"let code: cached call '%V' %ui", &pc->func->name, pc->arg);
+				break;
+
+			case NGX_LET_OP_MEMO:
+				ngx_log_debug(NGX_LOG_INFO, cf->log, 0, 
+						"let code: memo call '%V' %ui", &pc->func->name, pc->arg);
+				break;
+
+			case NGX_LET_OP_CONCAT:
+				ngx_log_debug(NGX_LOG_INFO, cf->log, 0, 
+						"let code: concat %ui", pc->arg);
+				break;
+
+			case NGX_LET_OP_SHARED:
+				ngx_log_debug(NGX_LOG_INFO, cf->log, 0, 
+						"let code: shared %ui", pc->arg);
+				break;
+
+			case NGX_LET_OP_OPTIONAL:
+				ngx_log_debug(NGX_LOG_INFO, cf->log, 0, 
+						"let code: optional variable %ui", pc->arg);
+				break;
+
+			case NGX_LET_OP_COMPARE:
+				ngx_log_debug(NGX_LOG_INFO, cf->log, 0, 
+						"let code: compare %s", 
+						pc->arg == NGX_LOP_EQ ? "==" : pc->arg == NGX_LOP_NE ? "!="
+						: pc->arg == '<' ? "<" : ">");
+				break;
+
+			case NGX_LET_OP_BOOL:
+				ngx_log_debug(NGX_LOG_INFO, cf->log, 0, "let code: bool");
+				break;
+
+			case NGX_LET_OP_JUMP:
+			case NGX_LET_OP_JUMP_FALSE:
+			case NGX_LET_OP_AND:
+			case NGX_LET_OP_OR:
+			case NGX_LET_OP_COALESCE:
+				ngx_log_debug(NGX_LOG_INFO, cf->log, 0, 
+						"let code: %s +%ui", 
+						ngx_let_jump_names[pc->code - NGX_LET_OP_JUMP], pc->arg);
+				break;
+
+			default:
+				ngx_log_debug(NGX_LOG_INFO, cf->log, 0, 
+						"let code: operation '%c'", (int)pc->arg);
+		}
+	}
+}
+
+static ngx_let_prog_t* ngx_let_compile(ngx_conf_t* cf, ngx_let_node_t* node,
+		char** err)
+{
+	ngx_let_compile_t lc;
+	ngx_let_prog_t* prog;
+	ngx_uint_t n;
+
+	if (ngx_array_init(&lc.code, cf->temp_pool, 16, sizeof(ngx_let_insn_t))
+			!= NGX_OK
+		|| ngx_array_init(&lc.exprs, cf->temp_pool, 4, sizeof(ngx_let_range_t))
+			!= NGX_OK)
+	{
+		*err = NGX_CONF_ERROR;
+		return NULL;
+	}
+
+	*err = ngx_let_compile_node(cf, &lc, node, 0);
+	if (*err != NGX_CONF_OK)
+		return NULL;
+
+	prog = ngx_pcalloc(cf->pool, sizeof(ngx_let_prog_t));
+	if (prog == NULL) {
+		*err = NGX_CONF_ERROR;
+		return NULL;
+	}
+
+	/* keep program contiguous & exactly sized */
+	prog->ncode = lc.code.nelts;
+	prog->code = ngx_palloc(cf->pool, lc.code.nelts * sizeof(ngx_let_insn_t));
+	if (prog->code == NULL) {
+		*err = NGX_CONF_ERROR;
+		return NULL;
+	}
+
+	ngx_memcpy(prog->code, lc.code.elts, lc.code.nelts * sizeof(ngx_let_insn_t));
+
+	/* impure calls survive folding & are never shared */
+	for(n = 0; n < prog->ncode; ++n) {
+
+		if (prog->code[n].code == NGX_LET_OP_CALL
+				&& !(prog->code[n].func->flags & NGX_LET_FUNC_PURE))
+			prog->nocacheable = 1;
+	}
+
+	prog->exprs = ngx_array_create(cf->temp_pool, lc.exprs.nelts + 1,
+			sizeof(ngx_let_range_t));
+	if (prog->exprs == NULL) {
+		*err = NGX_CONF_ERROR;
+		return NULL;
+	}
+
+	ngx_memcpy(ngx_array_push_n(prog->exprs, lc.exprs.nelts), lc.exprs.elts,
+			lc.exprs.nelts * sizeof(ngx_let_range_t));
+
+	ngx_log_debug1(NGX_LOG_DEBUG_HTTP, cf->log, 0, 
+			"let expression compiled: %d instructions", prog->ncode);
+
+	ngx_let_dump(cf, prog);
+
+	return prog;
+}
+
+/* Makes pure calls of program go through memo tables of n entries */
+static char* ngx_let_memoize(ngx_conf_t* cf, ngx_let_prog_t* prog,
+		ngx_uint_t n)
+{
+	ngx_let_insn_t *pc, *last;
+	ngx_let_memo_t* memo;
+	ngx_uint_t size;
+
+	for(size = NGX_LET_MEMO_WAYS; size < n; size <<= 1);
+
+	for(pc = prog->code, last = pc + prog->ncode; pc != last; ++pc) {
+
+		if (pc->code != NGX_LET_OP_CALL 
+				|| !(pc->func->flags & NGX_LET_FUNC_PURE))
+			continue;
+
+		memo = ngx_palloc(cf->pool, sizeof(ngx_let_memo_t));
+		if (memo == NULL)
+			return NGX_CONF_ERROR;
+
+		/* pages are copied on write so each worker gets own table */
+		memo->entries = ngx_pcalloc(cf->pool, 
+				size * sizeof(ngx_let_memo_entry_t));
+		if (memo->entries == NULL)
+			return NGX_CONF_ERROR;
+
+		memo->data = pc->data;
+		memo->mask = size - 1;
+		memo->clock = 0;
+
+		pc->code = NGX_LET_OP_MEMO;
+		pc->data = memo;
+	}
+
+	return NGX_CONF_OK;
+}
+
+/* Common subexpression elimination
+
+   Identical pure subexpressions of all let directives in a location are
+   moved into shared programs. Each shared value is stored in per-request
+   slot so it is computed at most once per request. */
+
+typedef struct ngx_let_expr_s ngx_let_expr_t;
+
+struct ngx_let_expr_s {
+
+	ngx_let_prog_t *prog;
+
+	ngx_uint_t start;
+
+	ngx_uint_t end;
+
+	ngx_uint_t hash;
+
+	ngx_int_t slot;       /* NGX_ERROR if not shared */
+
+	ngx_let_expr_t *first; /* first occurrence; NULL if this one */
+};
+
+static ngx_uint_t ngx_let_code_hash(ngx_let_insn_t* insn, ngx_uint_t n)
+{
+	ngx_uint_t key;
+
+	for(key = 0; n; --n, ++insn) {
+
+		key = ngx_hash(key, insn->code);
+		key = ngx_hash(key, insn->arg);
+		key = ngx_hash(key, (uintptr_t)insn->func);
+
+		if (insn->code == NGX_LET_OP_LITERAL)
+			key = ngx_hash(key, ngx_hash_key(insn->value.str.data, 
+						insn->value.str.len));
+	}
+
+	return key;
+}
+
+static ngx_uint_t ngx_let_code_equal(ngx_let_insn_t* a, ngx_let_insn_t* b,
+		ngx_uint_t n)
+{
+	for(; n; --n, ++a, ++b) {
+
+		if (a->code != b->code || a->arg != b->arg || a->func != b->func)
+			return 0;
+
+		if (a->code == NGX_LET_OP_CACHED
+				&& ((ngx_let_cache_site_t*)a->data)->ttl 
+					!= ((ngx_let_cache_site_t*)b->data)->ttl)
+			return 0;
+
+		if (a->code == NGX_LET_OP_LITERAL
+				&& (a->value.str.len != b->value.str.len
+					|| ngx_memcmp(a->value.str.data, b->value.str.data,
+						a->value.str.len)))
+			return 0;
+	}
+
+	return 1;
+}
+
+#define NGX_LET_NO_POS ((ngx_uint_t) -1)
+
+/* Copies code range replacing shared subexpressions with references */
+static ngx_int_t ngx_let_rewrite(ngx_conf_t* cf, ngx_array_t* exprs,
+		ngx_let_prog_t* prog, ngx_let_expr_t* self, ngx_let_insn_t** code,
+		ngx_uint_t* ncode)
+{
+	ngx_array_t out;
+	ngx_let_expr_t *e, *best;
+	ngx_let_insn_t* insn;
+	ngx_uint_t i, n, o, t, start, end, *map;
+
+	start = self ? self->start : 0;
+	end = self ? self->end : prog->ncode;
+
+	if (ngx_array_init(&out, cf->temp_pool, end - start, 
+				sizeof(ngx_let_insn_t)) != NGX_OK)
+		return NGX_ERROR;
+
+	/* new positions of instructions for relocating jumps */
+	map = ngx_palloc(cf->temp_pool, (end - start + 1) * sizeof(ngx_uint_t));
+	if (map == NULL)
+		return NGX_ERROR;
+
+	e = exprs->elts;
+
+	for(i = start; i < end; ) {
+
+		map[i - start] = out.nelts;
+
+		best = NULL;
+
+		/* outermost shared expression starting here */
+		for(n = 0; n < exprs->nelts; ++n) {
+
+			if (e[n].prog == prog && e[n].slot != NGX_ERROR && &e[n] != self
+					&& e[n].start == i && e[n].end <= end
+					&& (best == NULL || e[n].end > best->end))
+			{
+				best = &e[n];
+			}
+		}
+
+		insn = ngx_array_push(&out);
+		if (insn == NULL)
+			return NGX_ERROR;
+
+		if (best) {
+
+			ngx_memzero(insn, sizeof(ngx_let_insn_t));
+			insn->code = NGX_LET_OP_SHARED;
+			insn->arg = best->slot;
+
+			/* replaced instructions are not relocated */
+			while (++i < best->end)
+				map[i - start] = NGX_LET_NO_POS;
+
+		} else {
+
+			*insn = prog->code[i++];
+		}
+	}
+
+	map[end - start] = out.nelts;
+
+	/* jumps never target inside of shared expression */
+	insn = out.elts;
+
+	for(i = start; i < end; ++i) {
+
+		if (!ngx_let_is_jump(prog->code[i].code)
+				|| map[i - start] == NGX_LET_NO_POS)
+			continue;
+
+		o = map[i - start];
+		t = map[i - start + 1 + prog->code[i].arg];
+
+		insn[o].arg = t - o - 1;
+	}
+
+	*code = ngx_palloc(cf->pool, out.nelts * sizeof(ngx_let_insn_t));
+	if (*code == NULL)
+		return NGX_ERROR;
+
+	ngx_memcpy(*code, out.elts, out.nelts * sizeof(ngx_let_insn_t));
+	*ncode = out.nelts;
+
+	return NGX_OK;
+}
+
+static char* ngx_let_share(ngx_conf_t* cf, ngx_http_let_loc_conf_t* lcf)
+{
+	ngx_array_t exprs;
+	ngx_let_prog_t **progs, **shared, *sub;
+	ngx_let_range_t* range;
+	ngx_let_expr_t *e, *f;
+	ngx_let_insn_t* code;
+	ngx_uint_t i, j, n, nslots;
+
+	if (lcf->lets == NULL)
+		return NGX_CONF_OK;
+
+	if (ngx_array_init(&exprs, cf->temp_pool, 16, sizeof(ngx_let_expr_t))
+			!= NGX_OK)
+		return NGX_CONF_ERROR;
+
+	progs = lcf->lets->elts;
+
+	for(i = 0; i < lcf->lets->nelts; ++i) {
+
+		/* already processed */
+		if (progs[i]->exprs == NULL)
+			continue;
+
+		range = progs[i]->exprs->elts;
+
+		for(j = 0; j < progs[i]->exprs->nelts; ++j) {
+
+			e = ngx_array_push(&exprs);
+			if (e == NULL)
+				return NGX_CONF_ERROR;
+
+			e->prog = progs[i];
+			e->start = range[j].start;
+			e->end = range[j].end;
+			e->hash = ngx_let_code_hash(progs[i]->code + e->start, 
+					e->end - e->start);
+			e->slot = NGX_ERROR;
+			e->first = NULL;
+		}
+
+		progs[i]->exprs = NULL;
+	}
+
+	/* find repeated subexpressions */
+	e = exprs.elts;
+	nslots = 0;
+
+	for(i = 0; i < exprs.nelts; ++i) {
+
+		for(j = 0; j < i; ++j) {
+
+			if (e[j].first == NULL
+					&& e[j].hash == e[i].hash
+					&& e[j].end - e[j].start == e[i].end - e[i].start
+					&& ngx_let_code_equal(e[j].prog->code + e[j].start,
+						e[i].prog->code + e[i].start, e[i].end - e[i].start))
+			{
+				break;
+			}
+		}
+
+		if (j == i)
+			continue;
+
+		f = &e[j];
+
+		if (f->slot == NGX_ERROR)
+			f->slot = nslots++;
+
+		e[i].first = f;
+		e[i].slot = f->slot;
+	}
+
+	if (nslots == 0)
+		return NGX_CONF_OK;
+
+	lcf->shared = ngx_array_create(cf->pool, nslots, sizeof(ngx_let_prog_t*));
+	if (lcf->shared == NULL)
+		return NGX_CONF_ERROR;
+
+	shared = ngx_array_push_n(lcf->shared, nslots);
+
+	/* shared programs are built from original code first */
+	for(i = 0; i < exprs.nelts; ++i) {
+
+		if (e[i].first || e[i].slot == NGX_ERROR)
+			continue;
+
+		sub = ngx_pcalloc(cf->pool, sizeof(ngx_let_prog_t));
+		if (sub == NULL)
+			return NGX_CONF_ERROR;
+
+		sub->conf = lcf;
+
+		if (ngx_let_rewrite(cf, &exprs, e[i].prog, &e[i], &sub->code, 
+					&sub->ncode) != NGX_OK)
+			return NGX_CONF_ERROR;
+
+		shared[e[i].slot] = sub;
+	}
+
+	for(i = 0; i < lcf->lets->nelts; ++i) {
+
+		if (ngx_let_rewrite(cf, &exprs, progs[i], NULL, &code, &n) 
+				!= NGX_OK)
+			return NGX_CONF_ERROR;
+
+		progs[i]->code = code;
+		progs[i]->ncode = n;
+	}
+
+	for(i = 0; i < nslots; ++i) {
+
+		ngx_log_debug(NGX_LOG_INFO, cf->log, 0, "let shared expression %ui", i);
+		ngx_let_dump(cf, shared[i]);
+	}
+
+	for(i = 0; i < lcf->lets->nelts; ++i) {
+
+		ngx_log_debug(NGX_LOG_INFO, cf->log, 0, "let expression after sharing");
+		ngx_let_dump(cf, progs[i]);
+	}
+
+	return NGX_CONF_OK;
+}
+
+static ngx_int_t ngx_http_let_variable(ngx_http_request_t *r,
+		    ngx_http_variable_value_t *v, uintptr_t data)
+{
+	ngx_let_prog_t* prog = (ngx_let_prog_t*)data;
+	ngx_let_value_t value;
+	ngx_let_ctx_t ctx;
+	ngx_int_t ret;
+
+	ctx.request = r;
+	ctx.pool = r->pool;
+	ctx.log = r->connection->log;
+	ctx.nocache = 0;
+
+	ret = ngx_let_run(&ctx, prog, &value);
+
+	/* result is formatted only once, here */
+	if (ret == NGX_OK)
+		ret = ngx_let_value_str(&ctx, &value);
+
+	if (ret == NGX_OK) {
+
+		v->len = value.str.len;
+		v->data = value.str.data;
+		v->valid = 1;
+		v->no_cacheable = prog->nocacheable;
+		v->not_found = 0;
+			
+		ngx_log_debug0(NGX_LOG_DEBUG_HTTP, r->connection->log, 0, "let variable accessed");
+	}
+
+	return ret;
+}
+
+static void* ngx_http_let_create_main_conf(ngx_conf_t *cf)
+{
+	return ngx_pcalloc(cf->pool, sizeof(ngx_http_let_main_conf_t));
+}
+
+static char* ngx_http_let_init_main_conf(ngx_conf_t *cf, void *conf)
+{
+	ngx_http_let_main_conf_t *lmcf = conf;
+
+	if (lmcf->counters && lmcf->zone == NULL) {
+		ngx_conf_log_error(NGX_LOG_EMERG, cf, 0, 
+				"let counter functions require \"let_zone\"");
+		return NGX_CONF_ERROR;
+	}
+
+	if (lmcf->cached && lmcf->cache == NULL) {
+		ngx_conf_log_error(NGX_LOG_EMERG, cf, 0, 
+				"let cache() requires \"let_cache_zone\"");
+		return NGX_CONF_ERROR;
+	}
+
+	return NGX_CONF_OK;
+}
+
+static void* ngx_http_let_create_loc_conf(ngx_conf_t *cf)
+{
+	return ngx_pcalloc(cf->pool, sizeof(ngx_http_let_loc_conf_t));
+}
+
+static char* ngx_http_let_merge_loc_conf(ngx_conf_t *cf, void *parent,
+		void *child)
+{
+	/* all lets of location are known here */
+	return ngx_let_share(cf, child);
+}
+
+static ngx_int_t ngx_http_let_init_module(ngx_cycle_t *cycle)
+{
+#if (NGX_LET_HAVE_X86_SIMD)
+
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+		ngx_let_hex_encode = ngx_let_hex_avx2;
+
+	else if (__builtin_cpu_supports("ssse3"))
+		ngx_let_hex_encode = ngx_let_hex_ssse3;
+
+	if (__builtin_cpu_supports("sse4.2"))
+		ngx_let_crc32c = ngx_let_crc32c_sse42;
+
+	/* SSE2 is part of x86_64 */
+	ngx_let_find_kernel = __builtin_cpu_supports("avx2")
+		? ngx_let_find_avx2 : ngx_let_find_sse2;
+
+	ngx_let_nth_kernel = __builtin_cpu_supports("avx2")
+		&& __builtin_cpu_supports("popcnt")
+		? ngx_let_nth_avx2 : ngx_let_nth_sse2;
+
+	if (__builtin_cpu_supports("avx2")) {
+		ngx_let_case_scan = ngx_let_case_scan_avx2;
+		ngx_let_case_copy = ngx_let_case_copy_avx2;
+		ngx_let_json_classify = ngx_let_json_classify_avx2;
+
+		if (__builtin_cpu_supports("popcnt")) {
+			ngx_let_uri_count = ngx_let_uri_count_avx2;
+			ngx_let_utf8_length = ngx_let_utf8_length_avx2;
+			ngx_let_utf8_nth = ngx_let_utf8_nth_avx2;
+		}
+	}
+
+	ngx_log_debug1(NGX_LOG_DEBUG_CORE, cycle->log, 0, "let hex encoder: %s",
+			ngx_let_hex_encode == ngx_let_hex_avx2 ? "avx2" 
+			: ngx_let_hex_encode == ngx_let_hex_ssse3 ? "ssse3" : "scalar");
+#endif
+
+	return NGX_OK;
+}
+
+static ngx_int_t ngx_http_let_init_process(ngx_cycle_t *cycle)
+{
+	ngx_let_random_seed(cycle->log);
+
+	return NGX_OK;
+}
+
+/* Adds variable named by first argument evaluating expression */
+static char* ngx_http_let_add(ngx_conf_t *cf, ngx_http_let_loc_conf_t *lcf,
+		ngx_let_node_t *node, ngx_uint_t memo)
+{
+	ngx_str_t *value;
+	ngx_http_variable_t *v;
+	ngx_let_prog_t *prog, **pprog;
+	char *err;
+
+	value = cf->args->elts;
+
+	if (value[1].data[0] != '$')
+		return "needs variable as the first argument";
+
+	value[1].data++;
+	value[1].len--;
+
+	v = ngx_http_add_variable(cf, &value[1], NGX_HTTP_VAR_CHANGEABLE);
+	if (v == NULL)
+		return NGX_CONF_ERROR;
+
+	prog = ngx_let_compile(cf, node, &err);
+	if (prog == NULL)
+		return err;
+
+	if (memo) {
+
+		err = ngx_let_memoize(cf, prog, memo);
+		if (err != NGX_CONF_OK)
+			return err;
+	}
+
+	if (lcf->lets == NULL) {
+
+		lcf->lets = ngx_array_create(cf->pool, 4, sizeof(ngx_let_prog_t*));
+		if (lcf->lets == NULL)
+			return NGX_CONF_ERROR;
+	}
+
+	pprog = ngx_array_push(lcf->lets);
+	if (pprog == NULL)
+		return NGX_CONF_ERROR;
+
+	*pprog = prog;
+	prog->conf = lcf;
+
+	/* value changes on each access */
+	if (prog->nocacheable)
+		v->flags |= NGX_HTTP_VAR_NOCACHEABLE;
+
+	v->get_handler = ngx_http_let_variable;
+	v->data = (uintptr_t)prog;
+	
+	return NGX_CONF_OK;
+}
+
+static char* ngx_http_let_let(ngx_conf_t *cf, ngx_command_t *cmd, void *conf)
+{
+	ngx_str_t *value;
+	ngx_int_t memo;
+
+	ngx_log_debug0(NGX_LOG_INFO, cf->log, 0, "let command handler");
+
+	value = cf->args->elts;
+	memo = 0;
+
+	/* trailing memo=N is not part of expression */
+	if (cf->args->nelts > 3
+			&& ngx_strncmp(value[cf->args->nelts - 1].data, "memo=", 5) == 0)
+	{
+		memo = ngx_atoi(value[cf->args->nelts - 1].data + 5, 
+				value[cf->args->nelts - 1].len - 5);
+
+		if (memo <= 0 || memo > NGX_LET_MEMO_MAX) {
+			ngx_conf_log_error(NGX_LOG_EMERG, cf, 0, 
+					"let has invalid \"%V\"", &value[cf->args->nelts - 1]);
+			return NGX_CONF_ERROR;
+		}
+
+		cf->args->nelts--;
+	}
+
+	return ngx_http_let_add(cf, conf, ngx_parse_let_expr(cf), memo);
+}
+
+/* let_rand $var from to; same as let $var rand( from to ) */
+static char* ngx_http_let_rand(ngx_conf_t *cf, ngx_command_t *cmd, void *conf)
+{
+	ngx_let_node_t *node, *arg, **args;
+	ngx_str_t *value, name;
+	ngx_uint_t n;
+
+	value = cf->args->elts;
+
+	node = ngx_pcalloc(cf->pool, sizeof(ngx_let_node_t));
+	if (node == NULL)
+		return NGX_CONF_ERROR;
+
+	node->type = NGX_LTYPE_FUNCTION;
+	ngx_str_set(&node->name, "rand");
+
+	if (ngx_array_init(&node->args, cf->pool, 2, sizeof(ngx_let_node_t*))
+			!= NGX_OK)
+		return NGX_CONF_ERROR;
+
+	args = ngx_array_push_n(&node->args, 2);
+	if (args == NULL)
+		return NGX_CONF_ERROR;
+
+	for(n = 0; n < 2; ++n) {
+
+		arg = ngx_pcalloc(cf->pool, sizeof(ngx_let_node_t));
+		if (arg == NULL)
+			return NGX_CONF_ERROR;
+
+		if (value[n + 2].len > 1 && value[n + 2].data[0] == '$') {
+
+			name.data = value[n + 2].data + 1;
+			name.len = value[n + 2].len - 1;
+
+			arg->type = NGX_LTYPE_VARIABLE;
+			arg->index = ngx_http_get_variable_index(cf, &name);
+
+		} else {
+
+			arg->type = NGX_LTYPE_LITERAL;
+			arg->name = value[n + 2];
+		}
+
+		args[n] = arg;
+	}
+
+	return ngx_http_let_add(cf, conf, node, 0);
+}
+
+/* let_zone name size; shared memory for counters */
+static char* ngx_http_let_zone(ngx_conf_t *cf, ngx_command_t *cmd, void *conf)
+{
+	ngx_http_let_main_conf_t *lmcf = conf;
+	ngx_str_t *value;
+	ssize_t size;
+
+	if (lmcf->zone)
+		return "is duplicate";
+
+	value = cf->args->elts;
+
+	size = ngx_parse_size(&value[2]);
+
+	if (size == NGX_ERROR || size < (ssize_t) (8 * ngx_pagesize)) {
+		ngx_conf_log_error(NGX_LOG_EMERG, cf, 0, 
+				"let zone \"%V\" has invalid size \"%V\"", &value[1], &value[2]);
+		return NGX_CONF_ERROR;
+	}
+
+	lmcf->zone = ngx_shared_memory_add(cf, &value[1], size, 
+			&ngx_http_let_module);
+	if (lmcf->zone == NULL)
+		return NGX_CONF_ERROR;
+
+	if (lmcf->zone->data) {
+		ngx_conf_log_error(NGX_LOG_EMERG, cf, 0, 
+				"let zone \"%V\" is already used", &value[1]);
+		return NGX_CONF_ERROR;
+	}
+
+	lmcf->zone->init = ngx_http_let_init_zone;
+	lmcf->zone->data = lmcf;
+
+	return NGX_CONF_OK;
+}
+
+/* let_cache_zone name size; shared memory for cache() results */
+static char* ngx_http_let_cache_zone(ngx_conf_t *cf, ngx_command_t *cmd,
+		void *conf)
+{
+	ngx_http_let_main_conf_t *lmcf = conf;
+	ngx_let_cache_t *cache;
+	ngx_str_t *value;
+	ssize_t size;
+
+	if (lmcf->cache)
+		return "is duplicate";
+
+	value = cf->args->elts;
+
+	size = ngx_parse_size(&value[2]);
+
+	if (size == NGX_ERROR || size < (ssize_t) (8 * ngx_pagesize)) {
+		ngx_conf_log_error(NGX_LOG_EMERG, cf, 0, 
+				"let zone \"%V\" has invalid size \"%V\"", &value[1], &value[2]);
+		return NGX_CONF_ERROR;
+	}
+
+	cache = ngx_pcalloc(cf->pool, sizeof(ngx_let_cache_t));
+	if (cache == NULL)
+		return NGX_CONF_ERROR;
+
+	lmcf->cache = ngx_shared_memory_add(cf, &value[1], size, 
+			&ngx_http_let_module);
+	if (lmcf->cache == NULL)
+		return NGX_CONF_ERROR;
+
+	if (lmcf->cache->data) {
+		ngx_conf_log_error(NGX_LOG_EMERG, cf, 0, 
+				"let zone \"%V\" is already used", &value[1]);
+		return NGX_CONF_ERROR;
+	}
+
+	lmcf->cache->init = ngx_http_let_init_cache_zone;
+	lmcf->cache->data = cache;
 
-	v->get_handler = ngx_http_let_variable;
-	v->data = (uintptr_t)ngx_parse_let_expr(cf);
-	
 	return NGX_CONF_OK;
 }
 